@@ -0,0 +1,134 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* BenchmarkRunner.cpp                                                  */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "BenchmarkRunner.h"
+
+#include "SimdKernels.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHostInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cstdio>
+
+// Upper limit of iterations of a batch (for functions which are too fast to be timed)
+#define MAX_ITERATIONS 1000000000LL
+
+BenchmarkRunner::BenchmarkRunner(const QRegularExpression &filter, int minTime) :
+    m_filter(filter)
+{
+    m_minTime = (qint64)minTime * 1000000;
+}
+
+void BenchmarkRunner::run(const QString &name, const std::function<void()> &function)
+{
+    runTimed(name, [&function](qint64 nIterations) {
+        QElapsedTimer timer;
+        timer.start();
+        for (qint64 i = 0; i < nIterations; i++)
+        {
+            function();
+        }
+        return timer.nsecsElapsed();
+    });
+}
+
+void BenchmarkRunner::runTimed(const QString &name, const std::function<qint64(qint64 nIterations)> &function)
+{
+    if (!m_filter.match(name).hasMatch())
+    {
+        return;
+    }
+    // Warm-up (first call allocates buffers, fills caches)
+    function(1);
+    qint64 nIterations = 1;
+    while (true)
+    {
+        qint64 time = function(nIterations);
+        if ((time >= m_minTime) || (nIterations >= MAX_ITERATIONS))
+        {
+            Result result;
+            result.name = name;
+            result.nIterations = nIterations;
+            result.timePerIteration = (double)time / nIterations;
+            m_results.append(result);
+            printf("%-56s %14.0f ns %12lld iterations\n", qPrintable(name), result.timePerIteration, (long long)nIterations);
+            fflush(stdout);
+            return;
+        }
+        // Number of iterations predicted to take the minimum time (with some margin), growing at most tenfold per batch
+        double factor = (time > 0) ? (1.4 * m_minTime / time) : 10.0;
+        nIterations = std::min(MAX_ITERATIONS, std::max(nIterations + 1, (qint64)(nIterations * std::min(factor, 10.0))));
+    }
+}
+
+bool BenchmarkRunner::writeJson(const QString &fileName) const
+{
+    // Context: results are only comparable between runs on the same machine and libraries
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["host_name"] = QHostInfo::localHostName();
+    context["executable"] = QCoreApplication::applicationFilePath();
+    context["num_cpus"] = QThread::idealThreadCount();
+    context["qt_version"] = QString(qVersion());
+    context["opencv_version"] = QString(CV_VERSION);
+    context["simd_level"] = QString(getSimdLevelName(getSupportedSimdLevel()));
+    QJsonArray benchmarks;
+    foreach (const Result &result, m_results)
+    {
+        QJsonObject benchmark;
+        benchmark["name"] = result.name;
+        benchmark["iterations"] = (double)result.nIterations;
+        benchmark["real_time"] = result.timePerIteration;
+        benchmark["time_unit"] = QString("ns");
+        benchmarks.append(benchmark);
+    }
+    QJsonObject root;
+    root["context"] = context;
+    root["benchmarks"] = benchmarks;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    return file.write(QJsonDocument(root).toJson()) != -1;
+}
@@ -0,0 +1,66 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* BenchmarkRunner.h                                                    */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QList>
+#include <QRegularExpression>
+#include <QString>
+
+#include <functional>
+
+// Runs benchmarks (selected by a regular expression on their names) with an increasing number of iterations until a
+// batch takes at least the minimum time, prints the time per iteration and optionally writes all results as JSON
+class BenchmarkRunner
+{
+    public:
+        BenchmarkRunner(const QRegularExpression &filter, int minTime);
+        // Function runs one iteration per call (the whole batch is timed)
+        void run(const QString &name, const std::function<void()> &function);
+        // Function runs the given number of iterations and returns the time (ns) of the measured part
+        void runTimed(const QString &name, const std::function<qint64(qint64 nIterations)> &function);
+        bool writeJson(const QString &fileName) const;
+
+    private:
+        typedef struct
+        {
+            QString name;
+            qint64 nIterations;
+            double timePerIteration; // ns
+        } Result;
+        QRegularExpression m_filter;
+        qint64 m_minTime; // ns
+        QList<Result> m_results;
+};
+
+#endif // BENCHMARKRUNNER_H
@@ -0,0 +1,43 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* Benchmarks.h                                                         */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef BENCHMARKS_H
+#define BENCHMARKS_H
+
+#include "BenchmarkRunner.h"
+
+// Buffer<cv::Mat> (contention, drop policies, memory budget) and SharedImageBuffer::sync
+void runBufferBenchmarks(BenchmarkRunner &runner);
+// MatToQImage, processing stages and SIMD kernels at 640x480, 1920x1080 and 3840x2160
+void runImageBenchmarks(BenchmarkRunner &runner);
+
+#endif // BENCHMARKS_H
@@ -0,0 +1,188 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* BufferBenchmarks.cpp                                                 */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "Benchmarks.h"
+
+#include "Buffer.h"
+#include "FrameMemoryBudget.h"
+#include "SharedImageBuffer.h"
+
+#include <QElapsedTimer>
+#include <QMutex>
+
+#include <opencv2/opencv.hpp>
+
+#include <thread>
+#include <vector>
+
+#define BUFFER_SIZE         16
+#define BLOCK_TIMEOUT       100 // ms
+
+namespace {
+    // Producers add nItems frames in total (frames are shared, not copied), consumers take frames until they get an
+    // empty frame (end marker). Returns time (ns) until all frames were taken.
+    qint64 runProducersConsumers(Buffer<cv::Mat> &buffer, const cv::Mat &frame, qint64 nItems, int nProducers, int nConsumers, bool dropIfFull)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<std::thread> consumers;
+        for (int i = 0; i < nConsumers; i++)
+        {
+            consumers.push_back(std::thread([&buffer]() {
+                while (!buffer.get().empty())
+                {
+                }
+            }));
+        }
+        std::vector<std::thread> producers;
+        for (int i = 0; i < nProducers; i++)
+        {
+            qint64 nProducerItems = nItems / nProducers + ((i < nItems % nProducers) ? 1 : 0);
+            producers.push_back(std::thread([&buffer, &frame, nProducerItems, dropIfFull]() {
+                for (qint64 j = 0; j < nProducerItems; j++)
+                {
+                    buffer.add(frame, dropIfFull);
+                }
+            }));
+        }
+        for (size_t i = 0; i < producers.size(); i++)
+        {
+            producers[i].join();
+        }
+        // End markers (never dropped: buffer is not full once consumers are waiting)
+        for (int i = 0; i < nConsumers; i++)
+        {
+            buffer.add(cv::Mat());
+        }
+        for (size_t i = 0; i < consumers.size(); i++)
+        {
+            consumers[i].join();
+        }
+        return timer.nsecsElapsed();
+    }
+
+    // nThreads streams call SharedImageBuffer::sync nIterations times each. Returns time (ns) until all returned.
+    qint64 runSync(int nThreads, qint64 nIterations)
+    {
+        SharedImageBuffer sharedImageBuffer;
+        std::vector<Buffer<cv::Mat>*> imageBuffers;
+        for (int i = 0; i < nThreads; i++)
+        {
+            imageBuffers.push_back(new Buffer<cv::Mat>(1));
+            sharedImageBuffer.add(i, imageBuffers.back(), true);
+        }
+        sharedImageBuffer.setSyncEnabled(true);
+        // Streams are removed when done (as on disconnect), so streams which are behind are not left waiting
+        QMutex removeMutex;
+        QElapsedTimer timer;
+        timer.start();
+        std::vector<std::thread> threads;
+        for (int i = 0; i < nThreads; i++)
+        {
+            threads.push_back(std::thread([&sharedImageBuffer, &removeMutex, i, nIterations]() {
+                for (qint64 j = 0; j < nIterations; j++)
+                {
+                    sharedImageBuffer.sync(i);
+                }
+                QMutexLocker locker(&removeMutex);
+                sharedImageBuffer.removeByDeviceNumber(i);
+            }));
+        }
+        for (size_t i = 0; i < threads.size(); i++)
+        {
+            threads[i].join();
+        }
+        qint64 time = timer.nsecsElapsed();
+        for (size_t i = 0; i < imageBuffers.size(); i++)
+        {
+            delete imageBuffers[i];
+        }
+        return time;
+    }
+
+    const char *getPolicyName(FrameMemoryBudget::Policy policy)
+    {
+        switch (policy)
+        {
+            case FrameMemoryBudget::DropOldest:
+                return "DropOldest";
+            case FrameMemoryBudget::DegradeResolution:
+                return "DegradeResolution";
+            case FrameMemoryBudget::Block:
+                return "Block";
+        }
+        return "";
+    }
+}
+
+void runBufferBenchmarks(BenchmarkRunner &runner)
+{
+    cv::Mat frame(480, 640, CV_8UC3, cv::Scalar::all(0));
+
+    // Single thread: add and get (no waiting)
+    Buffer<cv::Mat> buffer(BUFFER_SIZE);
+    runner.run("Buffer/AddGet/SingleThread", [&]() {
+        buffer.add(frame);
+        buffer.get();
+    });
+    // Producers and consumers (waiting when full/empty)
+    const int nThreads[] = { 1, 2, 4 };
+    for (int n : nThreads)
+    {
+        runner.runTimed(QString("Buffer/ProducersConsumers/Block/%1:%1").arg(n), [&](qint64 nIterations) {
+            return runProducersConsumers(buffer, frame, nIterations, n, n, false);
+        });
+        runner.runTimed(QString("Buffer/ProducersConsumers/DropIfFull/%1:%1").arg(n), [&](qint64 nIterations) {
+            return runProducersConsumers(buffer, frame, nIterations, n, n, true);
+        });
+    }
+    // Memory budget policies (budget of 4 frames, buffer could hold more)
+    const FrameMemoryBudget::Policy policies[] = { FrameMemoryBudget::DropOldest, FrameMemoryBudget::DegradeResolution, FrameMemoryBudget::Block };
+    for (FrameMemoryBudget::Policy policy : policies)
+    {
+        runner.runTimed(QString("Buffer/MemoryBudget/%1/1:1").arg(getPolicyName(policy)), [&](qint64 nIterations) {
+            FrameMemoryBudget memoryBudget(4 * (qint64)frame.total() * frame.elemSize());
+            memoryBudget.addStream(0, 1, policy);
+            Buffer<cv::Mat> budgetedBuffer(BUFFER_SIZE);
+            budgetedBuffer.setMemoryBudget(&memoryBudget, 0, BLOCK_TIMEOUT);
+            return runProducersConsumers(budgetedBuffer, frame, nIterations, 1, 1, false);
+        });
+    }
+    // Synchronization of streams (time per sync of all streams)
+    const int nStreams[] = { 2, 4, 8 };
+    for (int n : nStreams)
+    {
+        runner.runTimed(QString("SharedImageBuffer/Sync/%1").arg(n), [n](qint64 nIterations) {
+            return runSync(n, nIterations);
+        });
+    }
+}
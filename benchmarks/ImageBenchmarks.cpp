@@ -0,0 +1,95 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ImageBenchmarks.cpp                                                  */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "Benchmarks.h"
+
+#include "ImageFilters.h"
+#include "MatToQImage.h"
+#include "SimdKernels.h"
+
+#include <opencv2/opencv.hpp>
+
+namespace {
+    // Test frame: smoothed noise (edges and texture at several scales, unlike a constant image)
+    cv::Mat makeFrame(cv::Size size)
+    {
+        cv::Mat frame(size, CV_8UC3);
+        cv::RNG rng(0x5EED);
+        rng.fill(frame, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(frame, frame, cv::Size(7, 7), 0);
+        return frame;
+    }
+}
+
+void runImageBenchmarks(BenchmarkRunner &runner)
+{
+    const cv::Size sizes[] = { cv::Size(640, 480), cv::Size(1920, 1080), cv::Size(3840, 2160) };
+    for (const cv::Size &size : sizes)
+    {
+        QString sizeName = QString("%1x%2").arg(size.width).arg(size.height);
+        cv::Mat frame = makeFrame(size);
+        cv::Mat grayFrame;
+        cv::cvtColor(frame, grayFrame, CV_BGR2GRAY);
+        // Destination is reused between iterations (as with the scratch arena of the processing thread)
+        cv::Mat result;
+
+        // Conversion for display
+        runner.run("MatToQImage/8UC1/" + sizeName, [&]() { MatToQImage(grayFrame); });
+        runner.run("MatToQImage/8UC3/" + sizeName, [&]() { MatToQImage(frame); });
+
+        // Processing stages (as called by ProcessingThread, default settings unless noted)
+        runner.run("Stage/Grayscale/" + sizeName, [&]() { bgrToGray(frame, result); });
+        runner.run("Stage/Blur3x3/" + sizeName, [&]() { boxBlur(frame, result, cv::Size(3, 3)); });
+        runner.run("Stage/Gaussian3x3/" + sizeName, [&]() { cv::GaussianBlur(frame, result, cv::Size(3, 3), 0, 0); });
+        runner.run("Stage/Median3/" + sizeName, [&]() { cv::medianBlur(frame, result, 3); });
+        runner.run("Stage/Median15/" + sizeName, [&]() { cv::medianBlur(frame, result, 15); });
+        runner.run("Stage/Dilate1/" + sizeName, [&]() { dilateRect(frame, result, 1); });
+        runner.run("Stage/Dilate5/" + sizeName, [&]() { dilateRect(frame, result, 5); });
+        runner.run("Stage/Erode1/" + sizeName, [&]() { erodeRect(frame, result, 1); });
+        runner.run("Stage/Erode5/" + sizeName, [&]() { erodeRect(frame, result, 5); });
+        runner.run("Stage/Flip/" + sizeName, [&]() { flipImage(frame, result, 1); });
+        runner.run("Stage/Canny/" + sizeName, [&]() { cv::Canny(grayFrame, result, 10, 100, 3, false); });
+        runner.run("Stage/GrayBlurCanny/" + sizeName, [&]() { grayBlurCanny(frame, result, cv::Size(3, 3), 10, 100, false); });
+
+        // SIMD kernels at each supported level, compared with OpenCV
+        runner.run("Kernel/BgrToGray/OpenCV/" + sizeName, [&]() { cv::cvtColor(frame, result, CV_BGR2GRAY); });
+        runner.run("Kernel/BoxBlur5x5/OpenCV/" + sizeName, [&]() { cv::blur(frame, result, cv::Size(5, 5)); });
+        runner.run("Kernel/Flip/OpenCV/" + sizeName, [&]() { cv::flip(frame, result, 1); });
+        for (int level = SimdScalar; level <= getSupportedSimdLevel(); level++)
+        {
+            QString levelName = getSimdLevelName(level);
+            runner.run(QString("Kernel/BgrToGray/%1/%2").arg(levelName, sizeName), [&]() { simdBgrToGray(frame, result, level); });
+            runner.run(QString("Kernel/BoxBlur5x5/%1/%2").arg(levelName, sizeName), [&]() { simdBoxBlur(frame, result, cv::Size(5, 5), level); });
+            runner.run(QString("Kernel/Flip/%1/%2").arg(levelName, sizeName), [&]() { simdFlip(frame, result, 1, level); });
+        }
+    }
+}
@@ -0,0 +1,70 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* main.cpp                                                             */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "Benchmarks.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    // Parse command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks of image buffers, frame conversion and processing stages.");
+    parser.addHelpOption();
+    QCommandLineOption filterOption("filter", "Run only benchmarks with names matching <regex>.", "regex", ".*");
+    QCommandLineOption minTimeOption("min-time", "Minimum time of each benchmark in ms.", "ms", "200");
+    QCommandLineOption jsonOption("json", "Write results to <file> (JSON).", "file");
+    parser.addOption(filterOption);
+    parser.addOption(minTimeOption);
+    parser.addOption(jsonOption);
+    parser.process(a);
+    QRegularExpression filter(parser.value(filterOption));
+    if (!filter.isValid())
+    {
+        qCritical() << "Invalid filter:" << filter.errorString();
+        return 1;
+    }
+    // Run benchmarks
+    BenchmarkRunner runner(filter, qMax(parser.value(minTimeOption).toInt(), 1));
+    runBufferBenchmarks(runner);
+    runImageBenchmarks(runner);
+    // Save results
+    if (parser.isSet(jsonOption) && !runner.writeJson(parser.value(jsonOption)))
+    {
+        qCritical() << "Could not write results to" << parser.value(jsonOption);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,187 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SoakStream.cpp                                                       */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SoakStream.h"
+
+#include "CaptureThread.h"
+#include "ProcessingThread.h"
+#include "SharedImageBuffer.h"
+#include "SyntheticFrameSource.h"
+#include "ThreadScheduling.h"
+#include "Timestamp.h"
+#include "Config.h"
+
+#include <QDebug>
+
+SoakStream::SoakStream(SharedImageBuffer *sharedImageBuffer, int deviceNumber, const SoakStreamOptions &options)
+{
+    m_sharedImageBuffer = sharedImageBuffer;
+    m_deviceNumber = deviceNumber;
+    m_options = options;
+    m_isRunning = false;
+    m_captureStats.nFramesProcessed = 0;
+    m_captureStats.nFramesDropped = 0;
+    m_processingStats.nFramesProcessed = 0;
+    m_processingStats.nFramesStale = 0;
+    m_processingStats.nFramesSuperseded = 0;
+    m_processingStats.nFramesLate = 0;
+    m_captureCpuTime = -1;
+    m_processingCpuTime = -1;
+
+    // Image buffer (accounted against frame memory budget, as for cameras)
+    Buffer<cv::Mat> *imageBuffer = new Buffer<cv::Mat>(options.bufferSize);
+    m_sharedImageBuffer->getFrameMemoryBudget()->addStream(deviceNumber, DEFAULT_FRAME_MEMORY_SHARE, FrameMemoryBudget::DropOldest);
+    imageBuffer->setMemoryBudget(m_sharedImageBuffer->getFrameMemoryBudget(), deviceNumber, FRAME_MEMORY_BLOCK_TIMEOUT);
+    m_sharedImageBuffer->add(deviceNumber, imageBuffer);
+
+    // Threads (capture thread takes ownership of source)
+    m_source = new SyntheticFrameSource(options.fps);
+    m_captureThread = new CaptureThread(m_sharedImageBuffer, deviceNumber, options.dropFrameIfBufferFull, options.width, options.height);
+    m_captureThread->setFrameSource(m_source);
+    m_processingThread = new ProcessingThread(m_sharedImageBuffer, deviceNumber);
+    // Statistics are emitted once per frame: collect them in the emitting thread (also gives the CPU time of the thread)
+    QObject::connect(m_captureThread, &CaptureThread::updateStatisticsInGUI, [this](ThreadStatisticsData statData) {
+        updateCaptureStats(statData);
+    });
+    QObject::connect(m_processingThread, &ProcessingThread::updateStatisticsInGUI, [this](ThreadStatisticsData statData) {
+        updateProcessingStats(statData);
+    });
+}
+
+SoakStream::~SoakStream()
+{
+    stop();
+    // Remove from shared buffer
+    Buffer<cv::Mat> *imageBuffer = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber);
+    m_sharedImageBuffer->removeByDeviceNumber(m_deviceNumber);
+    delete imageBuffer;
+    delete m_processingThread;
+    delete m_captureThread;
+}
+
+bool SoakStream::start()
+{
+    if (!m_captureThread->connectToCamera())
+    {
+        qDebug() << "[" << m_deviceNumber << "] ERROR: Could not open synthetic source.";
+        return false;
+    }
+    // Settings (as set by CameraView)
+    m_processingThread->setROI(QRect(0, 0, m_captureThread->getInputSourceWidth(), m_captureThread->getInputSourceHeight()));
+    m_processingThread->updateImageProcessingFlags(m_options.imgProcFlags);
+    m_processingThread->updateImageProcessingSettings(m_options.imgProcSettings);
+    m_processingThread->setProcessingDeadline(m_options.processingDeadline);
+    m_processingThread->setMaxFrameAge(m_options.maxFrameAge);
+    m_processingThread->setRawFormat(m_captureThread->getRawFormat());
+    if (m_options.autoPlaceThreads)
+    {
+        ThreadSchedulingData schedulingData;
+        schedulingData.cpus = getAutoPlacementCpus(m_deviceNumber);
+        schedulingData.policy = 0;
+        schedulingData.priority = 0;
+        m_captureThread->setScheduling(schedulingData);
+        m_processingThread->setScheduling(schedulingData);
+    }
+    // Start threads
+    m_captureThread->start((QThread::Priority)DEFAULT_CAP_THREAD_PRIO);
+    m_processingThread->start((QThread::Priority)DEFAULT_PROC_THREAD_PRIO);
+    m_isRunning = true;
+    return true;
+}
+
+void SoakStream::stop()
+{
+    if (!m_isRunning)
+    {
+        return;
+    }
+    // Stop processing thread (as CameraView::stopProcessingThread())
+    m_processingThread->stop();
+    m_sharedImageBuffer->wakeAll();
+    m_processingThread->wait();
+    // Stop capture thread: take one frame off a FULL buffer to allow the thread to finish (as CameraView::stopCaptureThread())
+    m_captureThread->stop();
+    m_sharedImageBuffer->wakeAll();
+    if (m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->isFull())
+    {
+        m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->get();
+    }
+    m_captureThread->wait();
+    m_captureThread->disconnectCamera();
+    m_isRunning = false;
+}
+
+SoakStreamSnapshot SoakStream::takeSnapshot()
+{
+    SoakStreamSnapshot snapshot;
+    snapshot.time = currentTimestamp();
+    snapshot.nFramesGrabbed = m_source->getGrabbedFrameCount();
+    snapshot.nFramesLost = m_source->getLostFrameCount();
+    QMutexLocker locker(&m_statsMutex);
+    snapshot.nFramesCaptured = m_captureStats.nFramesProcessed;
+    snapshot.nFramesDropped = m_captureStats.nFramesDropped;
+    snapshot.nFramesProcessed = m_processingStats.nFramesProcessed;
+    snapshot.nFramesStale = m_processingStats.nFramesStale;
+    snapshot.nFramesSuperseded = m_processingStats.nFramesSuperseded;
+    snapshot.nFramesLate = m_processingStats.nFramesLate;
+    snapshot.captureCpuTime = m_captureCpuTime;
+    snapshot.processingCpuTime = m_processingCpuTime;
+    snapshot.nLatencySamples = m_latencies.size();
+    return snapshot;
+}
+
+QVector<int> SoakStream::getLatencies(const SoakStreamSnapshot &from, const SoakStreamSnapshot &to)
+{
+    QMutexLocker locker(&m_statsMutex);
+    return m_latencies.mid(from.nLatencySamples, to.nLatencySamples - from.nLatencySamples);
+}
+
+void SoakStream::updateCaptureStats(const ThreadStatisticsData &statData)
+{
+    qint64 cpuTime = getCurrentThreadCpuTime();
+    QMutexLocker locker(&m_statsMutex);
+    m_captureStats = statData;
+    m_captureCpuTime = cpuTime;
+}
+
+void SoakStream::updateProcessingStats(const ThreadStatisticsData &statData)
+{
+    qint64 cpuTime = getCurrentThreadCpuTime();
+    QMutexLocker locker(&m_statsMutex);
+    // Statistics are also reported for skipped (stale, late or decimated) frames: only sample latency of processed frames
+    if ((statData.latency >= 0) && (statData.nFramesProcessed > m_processingStats.nFramesProcessed))
+    {
+        m_latencies.append(statData.latency);
+    }
+    m_processingStats = statData;
+    m_processingCpuTime = cpuTime;
+}
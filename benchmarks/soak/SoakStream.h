@@ -0,0 +1,108 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SoakStream.h                                                         */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef SOAKSTREAM_H
+#define SOAKSTREAM_H
+
+#include <QMutex>
+#include <QVector>
+
+#include "Structures.h"
+
+class SharedImageBuffer;
+class SyntheticFrameSource;
+class CaptureThread;
+class ProcessingThread;
+
+typedef struct
+{
+    int width;
+    int height;
+    double fps;
+    int bufferSize;
+    bool dropFrameIfBufferFull;
+    int maxFrameAge; // ms (0: process all frames in order)
+    int processingDeadline; // ms (0: no deadline)
+    bool autoPlaceThreads;
+    ImageProcessingFlags imgProcFlags;
+    ImageProcessingSettings imgProcSettings;
+} SoakStreamOptions;
+
+// Counters of a stream (cumulative since start, see SoakStream::takeSnapshot())
+typedef struct
+{
+    qint64 time; // ms (monotonic clock)
+    int nFramesGrabbed; // Source
+    int nFramesLost; // Source: not grabbed in time
+    int nFramesCaptured;
+    int nFramesDropped; // Capture: buffer full
+    int nFramesProcessed;
+    int nFramesStale; // Processing: older than maximum age
+    int nFramesSuperseded; // Processing: newer frame available
+    int nFramesLate; // Processing: past deadline
+    qint64 captureCpuTime; // ns (-1 if unknown)
+    qint64 processingCpuTime; // ns (-1 if unknown)
+    int nLatencySamples; // Size of latency log
+} SoakStreamSnapshot;
+
+// Stream of the real pipeline (CaptureThread -> SharedImageBuffer -> ProcessingThread) fed by a synthetic source.
+// Statistics are collected from the threads themselves (direct connections).
+class SoakStream
+{
+    public:
+        SoakStream(SharedImageBuffer *sharedImageBuffer, int deviceNumber, const SoakStreamOptions &options);
+        ~SoakStream();
+        bool start();
+        void stop();
+        SoakStreamSnapshot takeSnapshot();
+        // Latencies (capture to end of processing, ms) of frames processed between two snapshots
+        QVector<int> getLatencies(const SoakStreamSnapshot &from, const SoakStreamSnapshot &to);
+
+    private:
+        void updateCaptureStats(const ThreadStatisticsData &statData);
+        void updateProcessingStats(const ThreadStatisticsData &statData);
+        SharedImageBuffer *m_sharedImageBuffer;
+        SyntheticFrameSource *m_source;
+        CaptureThread *m_captureThread;
+        ProcessingThread *m_processingThread;
+        SoakStreamOptions m_options;
+        QMutex m_statsMutex;
+        ThreadStatisticsData m_captureStats;
+        ThreadStatisticsData m_processingStats;
+        qint64 m_captureCpuTime;
+        qint64 m_processingCpuTime;
+        QVector<int> m_latencies;
+        int m_deviceNumber;
+        bool m_isRunning;
+};
+
+#endif // SOAKSTREAM_H
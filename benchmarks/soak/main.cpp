@@ -0,0 +1,385 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* main.cpp                                                             */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SoakStream.h"
+#include "SharedImageBuffer.h"
+#include "SimdKernels.h"
+#include "Config.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QHostInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+typedef struct
+{
+    int nStreams;
+    bool isStarted; // False if a stream could not be started (level failed, no measurements)
+    double offeredFps; // Per stream
+    double processedFps; // Per stream
+    double dropRate; // % of offered frames: lost by source, dropped by buffer, stale, superseded or late
+    double sourceLossRate; // % (included in dropRate)
+    int latencyP50; // ms (-1 if no frame was processed)
+    int latencyP95;
+    int latencyP99;
+    double captureCpu; // % of one CPU per stream (-1 if unknown)
+    double processingCpu;
+} SoakResult;
+
+// Nearest-rank percentile of sorted values
+static int percentile(const QVector<int> &sortedValues, double p)
+{
+    if (sortedValues.isEmpty())
+    {
+        return -1;
+    }
+    int rank = (int)std::ceil(p / 100.0 * sortedValues.size());
+    return sortedValues.at(std::min(std::max(rank, 1), sortedValues.size()) - 1);
+}
+
+// CPU usage in % of one CPU (-1 if unknown)
+static double cpuUsage(qint64 from, qint64 to, qint64 duration)
+{
+    if ((from < 0) || (to < 0) || (duration <= 0))
+    {
+        return -1.0;
+    }
+    return 100.0 * (to - from) / (duration * 1000000.0);
+}
+
+static SoakResult runLevel(int nStreams, const SoakStreamOptions &options, int warmup, int duration)
+{
+    SoakResult result;
+    result.nStreams = nStreams;
+    result.isStarted = true;
+    result.offeredFps = 0.0;
+    result.processedFps = 0.0;
+    result.dropRate = 100.0;
+    result.sourceLossRate = 0.0;
+    result.latencyP50 = -1;
+    result.latencyP95 = -1;
+    result.latencyP99 = -1;
+    result.captureCpu = -1.0;
+    result.processingCpu = -1.0;
+    // Create and start streams
+    SharedImageBuffer sharedImageBuffer;
+    QList<SoakStream*> streams;
+    for (int i = 0; i < nStreams; i++)
+    {
+        SoakStream *stream = new SoakStream(&sharedImageBuffer, i, options);
+        streams.append(stream);
+        if (!stream->start())
+        {
+            result.isStarted = false;
+            break;
+        }
+    }
+    // Level fails if any stream could not be started
+    if (!result.isStarted)
+    {
+        foreach (SoakStream *stream, streams)
+        {
+            stream->stop();
+        }
+        qDeleteAll(streams);
+        return result;
+    }
+    // Measure after warm-up (buffers filled, scratch arenas and adaptive state settled)
+    QThread::msleep(warmup * 1000);
+    QList<SoakStreamSnapshot> start;
+    foreach (SoakStream *stream, streams)
+    {
+        start.append(stream->takeSnapshot());
+    }
+    QThread::msleep(duration * 1000);
+    QList<SoakStreamSnapshot> end;
+    foreach (SoakStream *stream, streams)
+    {
+        end.append(stream->takeSnapshot());
+    }
+    // Aggregate over streams
+    qint64 nOffered = 0;
+    qint64 nProcessed = 0;
+    qint64 nDropped = 0;
+    qint64 nLost = 0;
+    double captureCpu = 0.0;
+    double processingCpu = 0.0;
+    double time = 0.0;
+    QVector<int> latencies;
+    for (int i = 0; i < nStreams; i++)
+    {
+        const SoakStreamSnapshot &s = start.at(i);
+        const SoakStreamSnapshot &e = end.at(i);
+        qint64 streamTime = e.time - s.time;
+        nOffered += (e.nFramesGrabbed - s.nFramesGrabbed) + (e.nFramesLost - s.nFramesLost);
+        nProcessed += e.nFramesProcessed - s.nFramesProcessed;
+        nLost += e.nFramesLost - s.nFramesLost;
+        nDropped += (e.nFramesLost - s.nFramesLost) + (e.nFramesDropped - s.nFramesDropped) +
+                    (e.nFramesStale - s.nFramesStale) + (e.nFramesSuperseded - s.nFramesSuperseded) + (e.nFramesLate - s.nFramesLate);
+        double streamCaptureCpu = cpuUsage(s.captureCpuTime, e.captureCpuTime, streamTime);
+        double streamProcessingCpu = cpuUsage(s.processingCpuTime, e.processingCpuTime, streamTime);
+        captureCpu = ((captureCpu < 0.0) || (streamCaptureCpu < 0.0)) ? -1.0 : captureCpu + streamCaptureCpu;
+        processingCpu = ((processingCpu < 0.0) || (streamProcessingCpu < 0.0)) ? -1.0 : processingCpu + streamProcessingCpu;
+        time += streamTime / 1000.0;
+        latencies += streams.at(i)->getLatencies(s, e);
+    }
+    std::sort(latencies.begin(), latencies.end());
+    // Stop and remove streams
+    foreach (SoakStream *stream, streams)
+    {
+        stream->stop();
+    }
+    qDeleteAll(streams);
+
+    result.offeredFps = nOffered / time;
+    result.processedFps = nProcessed / time;
+    result.dropRate = (nOffered > 0) ? 100.0 * nDropped / nOffered : 0.0;
+    result.sourceLossRate = (nOffered > 0) ? 100.0 * nLost / nOffered : 0.0;
+    result.latencyP50 = percentile(latencies, 50.0);
+    result.latencyP95 = percentile(latencies, 95.0);
+    result.latencyP99 = percentile(latencies, 99.0);
+    result.captureCpu = (captureCpu < 0.0) ? -1.0 : captureCpu / nStreams;
+    result.processingCpu = (processingCpu < 0.0) ? -1.0 : processingCpu / nStreams;
+    return result;
+}
+
+static bool writeJson(const QString &fileName, const QJsonObject &options, const QList<SoakResult> &results, int knee)
+{
+    // Context: results are only comparable between runs on the same machine and libraries
+    QJsonObject context;
+    context["date"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+    context["host_name"] = QHostInfo::localHostName();
+    context["executable"] = QCoreApplication::applicationFilePath();
+    context["num_cpus"] = QThread::idealThreadCount();
+    context["qt_version"] = QString(qVersion());
+    context["opencv_version"] = QString(CV_VERSION);
+    context["simd_level"] = QString(getSimdLevelName(getSupportedSimdLevel()));
+    QJsonArray levels;
+    foreach (const SoakResult &result, results)
+    {
+        QJsonObject level;
+        level["streams"] = result.nStreams;
+        level["started"] = result.isStarted;
+        level["offered_fps_per_stream"] = result.offeredFps;
+        level["processed_fps_per_stream"] = result.processedFps;
+        level["drop_rate"] = result.dropRate;
+        level["source_loss_rate"] = result.sourceLossRate;
+        level["latency_p50"] = result.latencyP50;
+        level["latency_p95"] = result.latencyP95;
+        level["latency_p99"] = result.latencyP99;
+        level["capture_cpu_per_stream"] = result.captureCpu;
+        level["processing_cpu_per_stream"] = result.processingCpu;
+        levels.append(level);
+    }
+    QJsonObject root;
+    root["context"] = context;
+    root["options"] = options;
+    root["levels"] = levels;
+    root["knee"] = knee;
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+    return file.write(QJsonDocument(root).toJson()) != -1;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    // Parse command line
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Soak and scaling test: runs N synthetic streams through the capture, buffering and processing pipeline "
+                                     "and reports throughput, drops, latency and CPU usage for each N.");
+    parser.addHelpOption();
+    QCommandLineOption streamsOption("streams", "Numbers of concurrent streams to run (comma-separated).", "list", "1,2,4,8");
+    QCommandLineOption widthOption("width", "Frame width.", "pixels", QString::number(SYNTHETIC_SOURCE_DEFAULT_WIDTH));
+    QCommandLineOption heightOption("height", "Frame height.", "pixels", QString::number(SYNTHETIC_SOURCE_DEFAULT_HEIGHT));
+    QCommandLineOption fpsOption("fps", "Frame rate of each source.", "fps", "30");
+    QCommandLineOption warmupOption("warmup", "Time before measuring (per number of streams).", "s", "2");
+    QCommandLineOption durationOption("duration", "Measuring time (per number of streams).", "s", "10");
+    QCommandLineOption bufferSizeOption("buffer-size", "Image buffer size.", "frames", QString::number(DEFAULT_IMAGE_BUFFER_SIZE));
+    QCommandLineOption dropOption("drop", "Drop frames if image buffer is full (instead of blocking capture).");
+    QCommandLineOption maxFrameAgeOption("max-frame-age", "Skip frames older than <ms> (0: process all frames in order).", "ms", QString::number(DEFAULT_MAX_FRAME_AGE));
+    QCommandLineOption deadlineOption("deadline", "Processing deadline (0: no deadline).", "ms", QString::number(DEFAULT_PROCESSING_DEADLINE));
+    QCommandLineOption stagesOption("stages", "Processing stages (comma-separated: grayscale,smooth,dilate,erode,flip,canny).", "list", "");
+    QCommandLineOption autoPlaceOption("auto-place", "Pin the threads of each stream to CPUs sharing a cache.");
+    QCommandLineOption maxDropOption("max-drop", "Drop rate (%) above which a number of streams is not sustainable.", "percent", "1");
+    QCommandLineOption jsonOption("json", "Write results to <file> (JSON).", "file");
+    parser.addOption(streamsOption);
+    parser.addOption(widthOption);
+    parser.addOption(heightOption);
+    parser.addOption(fpsOption);
+    parser.addOption(warmupOption);
+    parser.addOption(durationOption);
+    parser.addOption(bufferSizeOption);
+    parser.addOption(dropOption);
+    parser.addOption(maxFrameAgeOption);
+    parser.addOption(deadlineOption);
+    parser.addOption(stagesOption);
+    parser.addOption(autoPlaceOption);
+    parser.addOption(maxDropOption);
+    parser.addOption(jsonOption);
+    parser.process(a);
+    QList<int> streamCounts;
+    foreach (const QString &value, parser.value(streamsOption).split(',', QString::SkipEmptyParts))
+    {
+        bool ok;
+        int nStreams = value.trimmed().toInt(&ok);
+        if (!ok || (nStreams < 1))
+        {
+            qCritical() << "Invalid number of streams:" << value;
+            return 1;
+        }
+        streamCounts.append(nStreams);
+    }
+    QStringList stages = parser.value(stagesOption).split(',', QString::SkipEmptyParts);
+    foreach (const QString &stage, stages)
+    {
+        if (!QStringList({"grayscale", "smooth", "dilate", "erode", "flip", "canny"}).contains(stage))
+        {
+            qCritical() << "Invalid processing stage:" << stage;
+            return 1;
+        }
+    }
+    SoakStreamOptions options;
+    options.width = qMax(parser.value(widthOption).toInt(), 16);
+    options.height = qMax(parser.value(heightOption).toInt(), 16);
+    options.fps = qMax(parser.value(fpsOption).toDouble(), 0.0);
+    options.bufferSize = qMax(parser.value(bufferSizeOption).toInt(), 1);
+    options.dropFrameIfBufferFull = parser.isSet(dropOption);
+    options.maxFrameAge = qMax(parser.value(maxFrameAgeOption).toInt(), 0);
+    options.processingDeadline = qMax(parser.value(deadlineOption).toInt(), 0);
+    options.autoPlaceThreads = parser.isSet(autoPlaceOption);
+    options.imgProcFlags.grayscaleOn = stages.contains("grayscale");
+    options.imgProcFlags.smoothOn = stages.contains("smooth");
+    options.imgProcFlags.dilateOn = stages.contains("dilate");
+    options.imgProcFlags.erodeOn = stages.contains("erode");
+    options.imgProcFlags.flipOn = stages.contains("flip");
+    options.imgProcFlags.cannyOn = stages.contains("canny");
+    options.imgProcSettings.smoothType = DEFAULT_SMOOTH_TYPE;
+    options.imgProcSettings.smoothParam1 = DEFAULT_SMOOTH_PARAM_1;
+    options.imgProcSettings.smoothParam2 = DEFAULT_SMOOTH_PARAM_2;
+    options.imgProcSettings.smoothParam3 = DEFAULT_SMOOTH_PARAM_3;
+    options.imgProcSettings.smoothParam4 = DEFAULT_SMOOTH_PARAM_4;
+    options.imgProcSettings.dilateNumberOfIterations = DEFAULT_DILATE_ITERATIONS;
+    options.imgProcSettings.erodeNumberOfIterations = DEFAULT_ERODE_ITERATIONS;
+    options.imgProcSettings.flipCode = DEFAULT_FLIP_CODE;
+    options.imgProcSettings.cannyThreshold1 = DEFAULT_CANNY_THRESHOLD_1;
+    options.imgProcSettings.cannyThreshold2 = DEFAULT_CANNY_THRESHOLD_2;
+    options.imgProcSettings.cannyApertureSize = DEFAULT_CANNY_APERTURE_SIZE;
+    options.imgProcSettings.cannyL2gradient = DEFAULT_CANNY_L2GRADIENT;
+    int warmup = qMax(parser.value(warmupOption).toInt(), 0);
+    int duration = qMax(parser.value(durationOption).toInt(), 1);
+    double maxDrop = parser.value(maxDropOption).toDouble();
+    // Select SIMD kernels once (as the application does at startup)
+    getSimdKernelSelection();
+
+    // Run each number of streams
+    printf("%8s %10s %10s %8s %8s %8s %8s %10s %10s %10s\n", "streams", "offered", "processed", "drop%", "p50 ms", "p95 ms", "p99 ms",
+           "src lost%", "cap cpu%", "proc cpu%");
+    QList<SoakResult> results;
+    int knee = -1; // Largest number of streams before the drop rate exceeds the limit (-1: limit not reached)
+    int lastSustained = 0;
+    bool isFailed = false; // A number of streams could not be started
+    foreach (int nStreams, streamCounts)
+    {
+        SoakResult result = runLevel(nStreams, options, warmup, duration);
+        results.append(result);
+        if (!result.isStarted)
+        {
+            // Counts as not sustained (drop rate of 100%)
+            printf("%8d FAILED: stream(s) could not be started\n", result.nStreams);
+            isFailed = true;
+        }
+        else
+        {
+            printf("%8d %10.1f %10.1f %8.2f %8d %8d %8d %10.2f %10.1f %10.1f\n", result.nStreams, result.offeredFps, result.processedFps,
+                   result.dropRate, result.latencyP50, result.latencyP95, result.latencyP99, result.sourceLossRate,
+                   result.captureCpu, result.processingCpu);
+        }
+        fflush(stdout);
+        if ((result.dropRate > maxDrop) && (knee == -1))
+        {
+            knee = lastSustained;
+        }
+        else if (knee == -1)
+        {
+            lastSustained = nStreams;
+        }
+    }
+    if (knee == -1)
+    {
+        printf("Drop rate stayed below %.2f%% for all numbers of streams.\n", maxDrop);
+    }
+    else
+    {
+        printf("Knee: %d stream(s) sustained, drop rate exceeds %.2f%% beyond.\n", knee, maxDrop);
+    }
+
+    // Save results
+    if (parser.isSet(jsonOption))
+    {
+        QJsonObject jsonOptions;
+        jsonOptions["width"] = options.width;
+        jsonOptions["height"] = options.height;
+        jsonOptions["fps"] = options.fps;
+        jsonOptions["buffer_size"] = options.bufferSize;
+        jsonOptions["drop"] = options.dropFrameIfBufferFull;
+        jsonOptions["max_frame_age"] = options.maxFrameAge;
+        jsonOptions["deadline"] = options.processingDeadline;
+        jsonOptions["stages"] = stages.join(',');
+        jsonOptions["auto_place"] = options.autoPlaceThreads;
+        jsonOptions["warmup"] = warmup;
+        jsonOptions["duration"] = duration;
+        jsonOptions["max_drop"] = maxDrop;
+        if (!writeJson(parser.value(jsonOption), jsonOptions, results, knee))
+        {
+            qCritical() << "Could not write results to" << parser.value(jsonOption);
+            return 1;
+        }
+    }
+    return isFailed ? 1 : 0;
+}
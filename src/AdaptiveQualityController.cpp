@@ -0,0 +1,158 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* AdaptiveQualityController.cpp                                        */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "AdaptiveQualityController.h"
+
+#include "Config.h"
+
+#include <QDateTime>
+
+namespace {
+    const int N_QUALITY_LEVELS = 5;
+    // Per level: process every Nth frame, scale applied before processing, optional stages on
+    const int FRAME_DECIMATION[N_QUALITY_LEVELS] = { 1, 1, 1, 2, 4 };
+    const double SCALE[N_QUALITY_LEVELS] = { 1.0, 1.0, 0.5, 0.5, 0.5 };
+    const bool OPTIONAL_STAGES_ON[N_QUALITY_LEVELS] = { true, false, false, false, false };
+}
+
+AdaptiveQualityController::AdaptiveQualityController(int optionalStages)
+{
+    m_optionalStages = optionalStages;
+    reset();
+}
+
+bool AdaptiveQualityController::update(double bufferOccupancy, double utilization)
+{
+    // Smooth measurements (exponential moving average)
+    m_bufferOccupancy += ADAPTIVE_QUALITY_SMOOTHING * (bufferOccupancy - m_bufferOccupancy);
+    m_utilization += ADAPTIVE_QUALITY_SMOOTHING * (utilization - m_utilization);
+
+    // Overloaded: frames are arriving faster than they are processed
+    if ((m_bufferOccupancy >= ADAPTIVE_QUALITY_HIGH_OCCUPANCY) || (m_utilization >= ADAPTIVE_QUALITY_HIGH_UTILIZATION))
+    {
+        m_nOverloadedSamples++;
+        m_nHeadroomSamples = 0;
+    }
+    // Headroom: buffer (nearly) empty and processing thread mostly idle
+    else if ((m_bufferOccupancy <= ADAPTIVE_QUALITY_LOW_OCCUPANCY) && (m_utilization <= ADAPTIVE_QUALITY_LOW_UTILIZATION))
+    {
+        m_nHeadroomSamples++;
+        m_nOverloadedSamples = 0;
+    }
+    // In between (hysteresis band): keep current level
+    else
+    {
+        m_nOverloadedSamples = 0;
+        m_nHeadroomSamples = 0;
+    }
+
+    // Step down quickly...
+    qint64 timeSinceLastChange = QDateTime::currentMSecsSinceEpoch() - m_lastChangeTime;
+    if ((m_nOverloadedSamples >= ADAPTIVE_QUALITY_STEP_DOWN_SAMPLES) && (m_level < N_QUALITY_LEVELS - 1) &&
+        (timeSinceLastChange >= ADAPTIVE_QUALITY_STEP_DOWN_HOLD_TIME))
+    {
+        setLevel(m_level + 1);
+        return true;
+    }
+    // ...but step up only after headroom has been stable for a while
+    if ((m_nHeadroomSamples >= ADAPTIVE_QUALITY_STEP_UP_SAMPLES) && (m_level > 0) &&
+        (timeSinceLastChange >= ADAPTIVE_QUALITY_STEP_UP_HOLD_TIME))
+    {
+        setLevel(m_level - 1);
+        return true;
+    }
+    return false;
+}
+
+void AdaptiveQualityController::reset()
+{
+    m_bufferOccupancy = 0.0;
+    m_utilization = 0.0;
+    m_lastChangeTime = 0;
+    m_level = 0;
+    m_nOverloadedSamples = 0;
+    m_nHeadroomSamples = 0;
+}
+
+int AdaptiveQualityController::getLevel() const
+{
+    return m_level;
+}
+
+int AdaptiveQualityController::getFrameDecimation() const
+{
+    return FRAME_DECIMATION[m_level];
+}
+
+double AdaptiveQualityController::getScale() const
+{
+    return SCALE[m_level];
+}
+
+ImageProcessingFlags AdaptiveQualityController::applyToFlags(const ImageProcessingFlags &flags) const
+{
+    ImageProcessingFlags result = flags;
+    if (!OPTIONAL_STAGES_ON[m_level])
+    {
+        result.smoothOn = flags.smoothOn && !(m_optionalStages & SmoothStage);
+        result.dilateOn = flags.dilateOn && !(m_optionalStages & DilateStage);
+        result.erodeOn = flags.erodeOn && !(m_optionalStages & ErodeStage);
+        result.cannyOn = flags.cannyOn && !(m_optionalStages & CannyStage);
+    }
+    return result;
+}
+
+QList<QualityLevelChangeData> AdaptiveQualityController::getEventLog() const
+{
+    return m_eventLog;
+}
+
+void AdaptiveQualityController::setLevel(int level)
+{
+    // Add event to log
+    QualityLevelChangeData event;
+    event.level = level;
+    event.previousLevel = m_level;
+    event.timestamp = QDateTime::currentMSecsSinceEpoch();
+    event.bufferOccupancy = m_bufferOccupancy;
+    event.utilization = m_utilization;
+    m_eventLog.enqueue(event);
+    if (m_eventLog.size() > ADAPTIVE_QUALITY_EVENT_LOG_LENGTH)
+    {
+        m_eventLog.dequeue();
+    }
+    // Set new level (measurements must be confirmed again at the new level)
+    m_level = level;
+    m_lastChangeTime = event.timestamp;
+    m_nOverloadedSamples = 0;
+    m_nHeadroomSamples = 0;
+}
@@ -0,0 +1,80 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* AdaptiveQualityController.h                                          */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef ADAPTIVEQUALITYCONTROLLER_H
+#define ADAPTIVEQUALITYCONTROLLER_H
+
+#include <QList>
+#include <QQueue>
+
+#include "Structures.h"
+
+// Steps the processing quality of a stream down when the processing thread cannot keep up (image buffer filling
+// up or no idle time left) and back up when there is headroom again. Quality levels:
+//  0: full quality
+//  1: optional stages disabled
+//  2: + frames downscaled by 2 before processing
+//  3: + every 2nd frame processed
+//  4: + every 4th frame processed
+class AdaptiveQualityController
+{
+    public:
+        // Stages which may be disabled
+        enum Stage
+        {
+            SmoothStage = 0x1,
+            DilateStage = 0x2,
+            ErodeStage = 0x4,
+            CannyStage = 0x8
+        };
+        AdaptiveQualityController(int optionalStages);
+        bool update(double bufferOccupancy, double utilization);
+        void reset();
+        int getLevel() const;
+        int getFrameDecimation() const;
+        double getScale() const;
+        ImageProcessingFlags applyToFlags(const ImageProcessingFlags &flags) const;
+        QList<QualityLevelChangeData> getEventLog() const;
+
+    private:
+        void setLevel(int level);
+        QQueue<QualityLevelChangeData> m_eventLog;
+        double m_bufferOccupancy;
+        double m_utilization;
+        qint64 m_lastChangeTime;
+        int m_optionalStages;
+        int m_level;
+        int m_nOverloadedSamples;
+        int m_nHeadroomSamples;
+};
+
+#endif // ADAPTIVEQUALITYCONTROLLER_H
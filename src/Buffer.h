@@ -37,14 +37,43 @@
 #include <QQueue>
 #include <QSemaphore>
 #include <QByteArray>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "BufferItemTraits.h"
+#include "FrameMemoryBudget.h"
+#include "Timestamp.h"
+
+template<class T> class Buffer;
+
+// Compresses items of a Buffer in the background (i.e. not in the producer thread)
+template<class T> class BufferCompressorThread : public QThread
+{
+    public:
+        BufferCompressorThread(Buffer<T> *buffer) : QThread(), m_buffer(buffer) {}
+
+    protected:
+        void run()
+        {
+            m_buffer->compressItems();
+        }
+
+    private:
+        Buffer<T> *m_buffer;
+};
 
 template<class T> class Buffer
 {
     public:
         Buffer(int size);
-        void add(const T& data, bool dropIfFull = false);
-        T get();
+        ~Buffer();
+        bool add(const T& data, bool dropIfFull = false, qint64 timestamp = -1);
+        T get(qint64 *timestamp = 0);
+        T getFresh(qint64 maxAge, qint64 *timestamp = 0, int *nStale = 0, int *nSuperseded = 0);
         bool clear();
+        void setCompressionEnabled(int nRawItems, int quality);
+        void setMemoryBudget(FrameMemoryBudget *memoryBudget, int memoryBudgetId, int blockTimeout);
+        int takeEvictedItemCount();
         int size() const
         {
             return m_queue.size();
@@ -61,32 +90,138 @@ template<class T> class Buffer
         {
             return m_queue.size() == 0;
         }
+        bool isCompressionEnabled() const
+        {
+            return m_compressorThread != 0;
+        }
 
     private:
+        friend class BufferCompressorThread<T>;
+        typedef struct
+        {
+            T data;
+            QByteArray compressedData;
+            quint64 id;
+            qint64 timestamp;
+            qint64 nBytes;
+            bool isCompressed;
+            bool isCompressionFailed;
+        } Item;
+        void compressItems();
+        bool acquireMemory(T &data, qint64 &nBytes);
+        bool dropOldestItem();
+        T takeItemData(Item &item, qint64 *timestamp);
+        void discardItem(const Item &item);
         QMutex m_queueProtectMutex;
-        QQueue<T> m_queue;
+        QQueue<Item> m_queue;
         QSemaphore *m_freeSlotsSemaphore;
         QSemaphore *m_usedSlotsSemaphore;
         QSemaphore *m_addProtectSemaphore;
         QSemaphore *m_getProtectSemaphore;
         int m_bufferSize;
+        quint64 m_nextItemId;
+        // Compression
+        BufferCompressorThread<T> *m_compressorThread;
+        QWaitCondition m_compressCondition;
+        int m_nRawItems;
+        int m_compressionQuality;
+        bool m_doStopCompression;
+        // Memory budget
+        FrameMemoryBudget *m_memoryBudget;
+        int m_memoryBudgetId;
+        int m_blockTimeout;
+        int m_nEvictedItems; // Dropped to make room in memory budget (only modified by add())
 };
 
 template<class T> Buffer<T>::Buffer(int size)
 {
     // Save buffer size
     m_bufferSize = size;
+    m_nextItemId = 0;
     // Create semaphores
     m_freeSlotsSemaphore = new QSemaphore(m_bufferSize);
     m_usedSlotsSemaphore = new QSemaphore(0);
     m_addProtectSemaphore = new QSemaphore(1);
     m_getProtectSemaphore = new QSemaphore(1);
+    // Compression is disabled by default
+    m_compressorThread = 0;
+    m_nRawItems = 0;
+    m_compressionQuality = 0;
+    m_doStopCompression = false;
+    // No memory budget by default
+    m_memoryBudget = 0;
+    m_memoryBudgetId = 0;
+    m_blockTimeout = 0;
+    m_nEvictedItems = 0;
+}
+
+template<class T> Buffer<T>::~Buffer()
+{
+    // Stop compressor thread
+    if (m_compressorThread != 0)
+    {
+        m_queueProtectMutex.lock();
+        m_doStopCompression = true;
+        m_compressCondition.wakeAll();
+        m_queueProtectMutex.unlock();
+        m_compressorThread->wait();
+        delete m_compressorThread;
+    }
+    // Return memory of remaining items to budget
+    if (m_memoryBudget != 0)
+    {
+        for (int i = 0; i < m_queue.size(); i++)
+        {
+            m_memoryBudget->release(m_memoryBudgetId, m_queue.at(i).nBytes);
+        }
+    }
+}
+
+template<class T> void Buffer<T>::setCompressionEnabled(int nRawItems, int quality)
+{
+    // Items at queue positions >= nRawItems (i.e. the most recently added items of a deep queue) are compressed.
+    // Must be called before the buffer is used.
+    if (m_compressorThread == 0)
+    {
+        m_nRawItems = nRawItems;
+        m_compressionQuality = quality;
+        m_compressorThread = new BufferCompressorThread<T>(this);
+        m_compressorThread->start(QThread::LowPriority);
+    }
+}
+
+template<class T> void Buffer<T>::setMemoryBudget(FrameMemoryBudget *memoryBudget, int memoryBudgetId, int blockTimeout)
+{
+    // Items added to the buffer are accounted against the part of the budget of memoryBudgetId.
+    // Must be called before the buffer is used.
+    m_memoryBudget = memoryBudget;
+    m_memoryBudgetId = memoryBudgetId;
+    m_blockTimeout = blockTimeout;
+}
+
+template<class T> int Buffer<T>::takeEvictedItemCount()
+{
+    // Number of items dropped by add() since last call to make room in memory budget (DropOldest policy). Must be
+    // called by the thread adding items.
+    int nEvictedItems = m_nEvictedItems;
+    m_nEvictedItems = 0;
+    return nEvictedItems;
 }
 
-template<class T> void Buffer<T>::add(const T& data, bool dropIfFull)
+template<class T> bool Buffer<T>::add(const T& data, bool dropIfFull, qint64 timestamp)
 {
     m_addProtectSemaphore->acquire();
 
+    // Account item against memory budget (drop item if this is not possible)
+    T budgetedData = data;
+    qint64 nBytes = 0;
+    if (!acquireMemory(budgetedData, nBytes))
+    {
+        m_addProtectSemaphore->release();
+        return false;
+    }
+    bool isAdded = true;
+
     // If dropping is enabled, do not block if buffer is full
     if(dropIfFull)
     {
@@ -95,11 +230,32 @@ template<class T> void Buffer<T>::add(const T& data, bool dropIfFull)
         {
             // Add item to queue
             m_queueProtectMutex.lock();
-            m_queue.enqueue(data);
+            Item item;
+            item.data = budgetedData;
+            item.id = m_nextItemId++;
+            item.timestamp = timestamp;
+            item.nBytes = nBytes;
+            item.isCompressed = false;
+            item.isCompressionFailed = false;
+            m_queue.enqueue(item);
+            // Wake compressor thread if item is beyond the raw head of the queue
+            if ((m_compressorThread != 0) && (m_queue.size() > m_nRawItems))
+            {
+                m_compressCondition.wakeOne();
+            }
             m_queueProtectMutex.unlock();
             // Release semaphore
             m_usedSlotsSemaphore->release();
         }
+        // Item was dropped
+        else
+        {
+            if (m_memoryBudget != 0)
+            {
+                m_memoryBudget->release(m_memoryBudgetId, nBytes);
+            }
+            isAdded = false;
+        }
     }
     // If buffer is full, wait on semaphore
     else
@@ -108,31 +264,143 @@ template<class T> void Buffer<T>::add(const T& data, bool dropIfFull)
         m_freeSlotsSemaphore->acquire();
         // Add item to queue
         m_queueProtectMutex.lock();
-        m_queue.enqueue(data);
+        Item item;
+        item.data = budgetedData;
+        item.id = m_nextItemId++;
+        item.timestamp = timestamp;
+        item.nBytes = nBytes;
+        item.isCompressed = false;
+        item.isCompressionFailed = false;
+        m_queue.enqueue(item);
+        // Wake compressor thread if item is beyond the raw head of the queue
+        if ((m_compressorThread != 0) && (m_queue.size() > m_nRawItems))
+        {
+            m_compressCondition.wakeOne();
+        }
         m_queueProtectMutex.unlock();
         // Release semaphore
         m_usedSlotsSemaphore->release();
     }
 
     m_addProtectSemaphore->release();
+    return isAdded;
 }
 
-template<class T> T Buffer<T>::get()
+template<class T> T Buffer<T>::get(qint64 *timestamp)
 {
-    T data;
+    Item item;
     m_getProtectSemaphore->acquire();
 
     // Acquire semaphores
     m_usedSlotsSemaphore->acquire();
     // Take item from queue
     m_queueProtectMutex.lock();
-    data = m_queue.dequeue();
+    item = m_queue.dequeue();
     m_queueProtectMutex.unlock();
     // Release semaphores
     m_freeSlotsSemaphore->release();
 
     m_getProtectSemaphore->release();
-    return data;
+
+    return takeItemData(item, timestamp);
+}
+
+template<class T> T Buffer<T>::getFresh(qint64 maxAge, qint64 *timestamp, int *nStale, int *nSuperseded)
+{
+    // Returns the newest item in the buffer: all older items are skipped, as stale if older than maxAge (ms since the
+    // timestamp passed to add()), as superseded otherwise. If the newest item is stale, it is skipped as well and an
+    // empty item is returned (so that the caller can report skipped items while no fresh items arrive).
+    Item item;
+    int nStaleItems = 0;
+    int nSupersededItems = 0;
+    m_getProtectSemaphore->acquire();
+
+    // Acquire semaphores (wait for at least one item, then take all items currently in buffer)
+    m_usedSlotsSemaphore->acquire();
+    int nItems = 1;
+    int nAvailable = m_usedSlotsSemaphore->available();
+    if ((nAvailable > 0) && m_usedSlotsSemaphore->tryAcquire(nAvailable))
+    {
+        nItems += nAvailable;
+    }
+    // Take items from queue (only the newest item is kept)
+    qint64 now = currentTimestamp();
+    m_queueProtectMutex.lock();
+    for (int i = 0; i < nItems; i++)
+    {
+        if (i > 0)
+        {
+            if ((item.timestamp >= 0) && (now - item.timestamp > maxAge))
+            {
+                nStaleItems++;
+            }
+            else
+            {
+                nSupersededItems++;
+            }
+            discardItem(item);
+        }
+        item = m_queue.dequeue();
+    }
+    m_queueProtectMutex.unlock();
+    // Release semaphores
+    m_freeSlotsSemaphore->release(nItems);
+
+    m_getProtectSemaphore->release();
+
+    // Newest item is too old
+    bool isStale = (item.timestamp >= 0) && (now - item.timestamp > maxAge);
+    if (isStale)
+    {
+        discardItem(item);
+        nStaleItems++;
+    }
+    // Return numbers of items skipped (if requested)
+    if (nStale != 0)
+    {
+        *nStale = nStaleItems;
+    }
+    if (nSuperseded != 0)
+    {
+        *nSuperseded = nSupersededItems;
+    }
+    if (isStale)
+    {
+        if (timestamp != 0)
+        {
+            *timestamp = item.timestamp;
+        }
+        return T();
+    }
+    return takeItemData(item, timestamp);
+}
+
+template<class T> T Buffer<T>::takeItemData(Item &item, qint64 *timestamp)
+{
+    // Return memory to budget
+    discardItem(item);
+
+    // Return timestamp passed to add() (if requested)
+    if (timestamp != 0)
+    {
+        *timestamp = item.timestamp;
+    }
+
+    // Decompress item (in consumer thread)
+    if (item.isCompressed)
+    {
+        return BufferItemTraits<T>::decompress(item.compressedData);
+    }
+    return item.data;
+}
+
+template<class T> void Buffer<T>::discardItem(const Item &item)
+{
+    // Return memory to budget
+    if (m_memoryBudget != 0)
+    {
+        m_memoryBudget->release(m_memoryBudgetId, item.nBytes);
+    }
 }
 
 template<class T> bool Buffer<T>::clear()
@@ -153,7 +421,17 @@ template<class T> bool Buffer<T>::clear()
                 // Reset usedSlots to zero
                 m_usedSlotsSemaphore->acquire(m_queue.size());
                 // Clear buffer
+                m_queueProtectMutex.lock();
+                // Return memory to budget
+                if (m_memoryBudget != 0)
+                {
+                    for (int i = 0; i < m_queue.size(); i++)
+                    {
+                        m_memoryBudget->release(m_memoryBudgetId, m_queue.at(i).nBytes);
+                    }
+                }
                 m_queue.clear();
+                m_queueProtectMutex.unlock();
                 // Release all slots
                 m_freeSlotsSemaphore->release(m_bufferSize);
                 // Allow get method to resume
@@ -178,4 +456,127 @@ template<class T> bool Buffer<T>::clear()
     }
 }
 
+template<class T> void Buffer<T>::compressItems()
+{
+    while(1)
+    {
+        // Wait for an uncompressed item beyond the raw head of the queue
+        m_queueProtectMutex.lock();
+        int index = -1;
+        while (!m_doStopCompression)
+        {
+            for (int i = m_nRawItems; i < m_queue.size(); i++)
+            {
+                if (!m_queue.at(i).isCompressed && !m_queue.at(i).isCompressionFailed)
+                {
+                    index = i;
+                    break;
+                }
+            }
+            if (index != -1)
+            {
+                break;
+            }
+            m_compressCondition.wait(&m_queueProtectMutex);
+        }
+        if (m_doStopCompression)
+        {
+            m_queueProtectMutex.unlock();
+            break;
+        }
+        T data = m_queue.at(index).data;
+        quint64 id = m_queue.at(index).id;
+        m_queueProtectMutex.unlock();
+
+        // Compress item (queue is not locked)
+        QByteArray compressedData;
+        bool result = BufferItemTraits<T>::compress(data, compressedData, m_compressionQuality);
+        data = T();
+
+        // Replace item with compressed version (unless it has been taken from the queue in the meantime)
+        m_queueProtectMutex.lock();
+        for (int i = 0; i < m_queue.size(); i++)
+        {
+            if (m_queue.at(i).id == id)
+            {
+                if (result)
+                {
+                    m_queue[i].compressedData = compressedData;
+                    m_queue[i].data = T();
+                    m_queue[i].isCompressed = true;
+                    // Compressed item uses less of the memory budget
+                    if ((m_memoryBudget != 0) && (compressedData.size() < m_queue[i].nBytes))
+                    {
+                        m_memoryBudget->release(m_memoryBudgetId, m_queue[i].nBytes - compressedData.size());
+                        m_queue[i].nBytes = compressedData.size();
+                    }
+                }
+                else
+                {
+                    m_queue[i].isCompressionFailed = true;
+                }
+                break;
+            }
+        }
+        m_queueProtectMutex.unlock();
+    }
+}
+
+template<class T> bool Buffer<T>::acquireMemory(T &data, qint64 &nBytes)
+{
+    // No memory budget
+    if (m_memoryBudget == 0)
+    {
+        nBytes = 0;
+        return true;
+    }
+
+    nBytes = BufferItemTraits<T>::size(data);
+    switch (m_memoryBudget->getPolicy(m_memoryBudgetId))
+    {
+        // Make room by dropping the oldest items in the buffer
+        case FrameMemoryBudget::DropOldest:
+            while (!m_memoryBudget->tryAcquire(m_memoryBudgetId, nBytes))
+            {
+                if (!dropOldestItem())
+                {
+                    return false;
+                }
+            }
+            return true;
+        // Reduce resolution of the item until it fits
+        case FrameMemoryBudget::DegradeResolution:
+            while (!m_memoryBudget->tryAcquire(m_memoryBudgetId, nBytes))
+            {
+                if (!BufferItemTraits<T>::downscale(data))
+                {
+                    return false;
+                }
+                nBytes = BufferItemTraits<T>::size(data);
+            }
+            return true;
+        // Wait for items to be taken from the buffer
+        case FrameMemoryBudget::Block:
+            return m_memoryBudget->acquire(m_memoryBudgetId, nBytes, m_blockTimeout);
+    }
+    return false;
+}
+
+template<class T> bool Buffer<T>::dropOldestItem()
+{
+    // Buffer is empty (or the remaining items are currently being taken from the buffer)
+    if (!m_usedSlotsSemaphore->tryAcquire())
+    {
+        return false;
+    }
+    m_queueProtectMutex.lock();
+    Item item = m_queue.dequeue();
+    m_queueProtectMutex.unlock();
+    m_freeSlotsSemaphore->release();
+    // Return memory to budget
+    discardItem(item);
+    m_nEvictedItems++;
+    return true;
+}
+
 #endif // BUFFER_H
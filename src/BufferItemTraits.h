@@ -0,0 +1,137 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* BufferItemTraits.h                                                   */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef BUFFERITEMTRAITS_H
+#define BUFFERITEMTRAITS_H
+
+#include <QByteArray>
+
+#include <opencv2/opencv.hpp>
+
+#include <vector>
+
+// Item-type specific operations used by Buffer<T>. By default items cannot be compressed.
+template<class T> struct BufferItemTraits
+{
+    static bool compress(const T &data, QByteArray &compressedData, int quality)
+    {
+        Q_UNUSED(data);
+        Q_UNUSED(compressedData);
+        Q_UNUSED(quality);
+        return false;
+    }
+    static T decompress(const QByteArray &compressedData)
+    {
+        Q_UNUSED(compressedData);
+        return T();
+    }
+    static qint64 size(const T &data)
+    {
+        Q_UNUSED(data);
+        return 0;
+    }
+    static bool downscale(T &data)
+    {
+        Q_UNUSED(data);
+        return false;
+    }
+};
+
+// Frames are compressed as JPEG (quality 1-100) or, if quality is 0, as lossless PNG (fastest compression level)
+template<> struct BufferItemTraits<cv::Mat>
+{
+    // Raw frames which are already compressed (e.g. Motion JPEG bitstream) are single-row byte arrays
+    static bool isCompressedFrame(const cv::Mat &frame)
+    {
+        return (frame.rows == 1) && (frame.type() == CV_8UC1);
+    }
+    static bool compress(const cv::Mat &frame, QByteArray &compressedData, int quality)
+    {
+        // Compressed frames are kept as they are (encoding the bitstream as an image would corrupt it)
+        if (isCompressedFrame(frame))
+        {
+            return false;
+        }
+        std::vector<uchar> buffer;
+        std::vector<int> params;
+        bool result = false;
+        try
+        {
+            // Lossless
+            if ((quality <= 0) && (frame.depth() == CV_8U) && (frame.channels() != 2))
+            {
+                params.push_back(cv::IMWRITE_PNG_COMPRESSION);
+                params.push_back(1);
+                result = cv::imencode(".png", frame, buffer, params);
+            }
+            // JPEG (1 or 3 channels only)
+            else if ((quality > 0) && (frame.type() == CV_8UC1 || frame.type() == CV_8UC3))
+            {
+                params.push_back(cv::IMWRITE_JPEG_QUALITY);
+                params.push_back(quality);
+                result = cv::imencode(".jpg", frame, buffer, params);
+            }
+        }
+        catch (cv::Exception &)
+        {
+            result = false;
+        }
+        if (result)
+        {
+            compressedData = QByteArray((const char*)buffer.data(), (int)buffer.size());
+        }
+        return result;
+    }
+    static cv::Mat decompress(const QByteArray &compressedData)
+    {
+        cv::Mat encoded(1, compressedData.size(), CV_8UC1, (void*)compressedData.constData());
+        return cv::imdecode(encoded, cv::IMREAD_UNCHANGED);
+    }
+    static qint64 size(const cv::Mat &frame)
+    {
+        return (qint64)(frame.total() * frame.elemSize());
+    }
+    // Halves the resolution of the frame (raw frames, i.e. compressed or 2-channel YUV, cannot be downscaled)
+    static bool downscale(cv::Mat &frame)
+    {
+        if ((frame.cols < 2) || (frame.rows < 2) || (frame.channels() == 2))
+        {
+            return false;
+        }
+        cv::Mat downscaledFrame;
+        cv::resize(frame, downscaledFrame, cv::Size(frame.cols / 2, frame.rows / 2), 0, 0, cv::INTER_AREA);
+        frame = downscaledFrame;
+        return true;
+    }
+};
+
+#endif // BUFFERITEMTRAITS_H
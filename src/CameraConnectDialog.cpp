@@ -34,10 +34,13 @@
 #include "ui_CameraConnectDialog.h"
 
 #include "Config.h"
+#include "ThreadScheduling.h"
 
 #include <QThread>
 #include <QMessageBox>
 
+#include <opencv2/opencv.hpp>
+
 CameraConnectDialog::CameraConnectDialog(QWidget *parent, bool isStreamSyncEnabled) :
     QDialog(parent),
     ui(new Ui::CameraConnectDialog)
@@ -60,17 +63,70 @@ CameraConnectDialog::CameraConnectDialog(QWidget *parent, bool isStreamSyncEnabl
     QRegExp rx4("^[0-9]{1,4}$"); // Integers 0 to 9999
     QRegExpValidator *validator4 = new QRegExpValidator(rx4, 0);
     ui->resHEdit->setValidator(validator4);
+    // compressRawFramesEdit (number of uncompressed frames at head of buffer) input validation
+    QRegExp rx5("^[0-9]{1,3}$"); // Integers 0 to 999
+    QRegExpValidator *validator5 = new QRegExpValidator(rx5, 0);
+    ui->compressRawFramesEdit->setValidator(validator5);
+    // compressQualityEdit (compression quality) input validation
+    QRegExp rx6("^(100|[0-9]{1,2})$"); // Integers 0 to 100
+    QRegExpValidator *validator6 = new QRegExpValidator(rx6, 0);
+    ui->compressQualityEdit->setValidator(validator6);
+    // memoryShareEdit (share of frame memory budget) input validation
+    QRegExp rx7("^[1-9][0-9]{0,2}$"); // Integers 1 to 999
+    QRegExpValidator *validator7 = new QRegExpValidator(rx7, 0);
+    ui->memoryShareEdit->setValidator(validator7);
+    // processingDeadlineEdit (processing deadline) input validation
+    QRegExp rx8("^[0-9]{1,4}$"); // Integers 0 to 9999
+    QRegExpValidator *validator8 = new QRegExpValidator(rx8, 0);
+    ui->processingDeadlineEdit->setValidator(validator8);
+    // maxFrameAgeEdit (maximum age of processed frames) input validation
+    QRegExp rx9("^[0-9]{1,4}$"); // Integers 0 to 9999
+    QRegExpValidator *validator9 = new QRegExpValidator(rx9, 0);
+    ui->maxFrameAgeEdit->setValidator(validator9);
+    // captureDecimationEdit (keep 1 of N frames) input validation
+    QRegExp rx10("^[1-9][0-9]{0,2}$"); // Integers 1 to 999
+    QRegExpValidator *validator10 = new QRegExpValidator(rx10, 0);
+    ui->captureDecimationEdit->setValidator(validator10);
+    // captureTargetFpsEdit (maximum capture frame rate) input validation
+    QRegExp rx11("^[0-9]{1,3}(\\.[0-9]{1,2})?$"); // 0 to 999.99
+    QRegExpValidator *validator11 = new QRegExpValidator(rx11, 0);
+    ui->captureTargetFpsEdit->setValidator(validator11);
+    // captureCpusEdit/processingCpusEdit (CPU affinity, e.g. "0-1,4") input validation
+    QRegExp rx12("^[0-9]{1,3}(-[0-9]{1,3})?(,[0-9]{1,3}(-[0-9]{1,3})?)*$");
+    QRegExpValidator *validator12 = new QRegExpValidator(rx12, 0);
+    ui->captureCpusEdit->setValidator(validator12);
+    ui->processingCpusEdit->setValidator(validator12);
+    // schedulingPriorityEdit (real-time priority) input validation
+    QRegExp rx13("^[1-9][0-9]?$"); // Integers 1 to 99
+    QRegExpValidator *validator13 = new QRegExpValidator(rx13, 0);
+    ui->schedulingPriorityEdit->setValidator(validator13);
     // Setup combo boxes
     QStringList threadPriorities;
     threadPriorities << tr("Idle") << tr("Lowest") << tr("Low") << tr("Normal") << tr("High") << tr("Highest") << tr("Time Critical") << tr("Inherit");
     ui->capturePrioComboBox->addItems(threadPriorities);
     ui->processingPrioComboBox->addItems(threadPriorities);
+    QStringList memoryPolicies;
+    memoryPolicies << tr("Drop oldest frames") << tr("Degrade resolution") << tr("Block");
+    ui->memoryPolicyComboBox->addItems(memoryPolicies);
+    QStringList backPressureModes;
+    backPressureModes << tr("Do nothing") << tr("Skip decoding frames") << tr("Lower camera frame rate");
+    ui->backPressureComboBox->addItems(backPressureModes);
+    QStringList pixelFormats;
+    pixelFormats << tr("Default") << tr("MJPG") << tr("YUYV") << tr("GREY");
+    ui->pixelFormatComboBox->addItems(pixelFormats);
+    QStringList schedulingPolicies;
+    schedulingPolicies << tr("Default") << tr("SCHED_FIFO") << tr("SCHED_RR");
+    ui->schedulingPolicyComboBox->addItems(schedulingPolicies);
     // Set dialog to defaults
     resetToDefaults();
     // Enable/disable checkbox
     ui->enableFrameProcessingCheckBox->setEnabled(isStreamSyncEnabled);
     // Connect button to slot
     connect(ui->resetToDefaultsPushButton, &QPushButton::released, this, &CameraConnectDialog::resetToDefaults);
+    connect(ui->compressBufferCheckBox, &QCheckBox::toggled, ui->compressRawFramesEdit, &QLineEdit::setEnabled);
+    connect(ui->compressBufferCheckBox, &QCheckBox::toggled, ui->compressQualityEdit, &QLineEdit::setEnabled);
+    ui->compressRawFramesEdit->setEnabled(ui->compressBufferCheckBox->isChecked());
+    ui->compressQualityEdit->setEnabled(ui->compressBufferCheckBox->isChecked());
 }
 
 CameraConnectDialog::~CameraConnectDialog()
@@ -144,6 +200,178 @@ bool CameraConnectDialog::getDropFrameCheckBoxState()
     return ui->dropFrameCheckBox->isChecked();
 }
 
+bool CameraConnectDialog::getBufferCompressionCheckBoxState()
+{
+    return ui->compressBufferCheckBox->isChecked();
+}
+
+int CameraConnectDialog::getBufferCompressionRawFrames()
+{
+    // Set number of uncompressed frames to default if field is blank
+    if(ui->compressRawFramesEdit->text().isEmpty())
+    {
+        return DEFAULT_BUFFER_COMPRESSION_RAW_FRAMES;
+    }
+    else
+    {
+        return ui->compressRawFramesEdit->text().toInt();
+    }
+}
+
+int CameraConnectDialog::getBufferCompressionQuality()
+{
+    // Set compression quality to default if field is blank
+    if(ui->compressQualityEdit->text().isEmpty())
+    {
+        return DEFAULT_BUFFER_COMPRESSION_QUALITY;
+    }
+    else
+    {
+        return ui->compressQualityEdit->text().toInt();
+    }
+}
+
+int CameraConnectDialog::getFrameMemoryShare()
+{
+    // Set share to default if field is blank
+    if(ui->memoryShareEdit->text().isEmpty())
+    {
+        return DEFAULT_FRAME_MEMORY_SHARE;
+    }
+    else
+    {
+        return ui->memoryShareEdit->text().toInt();
+    }
+}
+
+int CameraConnectDialog::getFrameMemoryPolicy()
+{
+    return ui->memoryPolicyComboBox->currentIndex();
+}
+
+int CameraConnectDialog::getProcessingDeadline()
+{
+    // Set processing deadline to default if field is blank
+    if(ui->processingDeadlineEdit->text().isEmpty())
+    {
+        return DEFAULT_PROCESSING_DEADLINE;
+    }
+    else
+    {
+        return ui->processingDeadlineEdit->text().toInt();
+    }
+}
+
+int CameraConnectDialog::getMaxFrameAge()
+{
+    // Set maximum frame age to default if field is blank
+    if(ui->maxFrameAgeEdit->text().isEmpty())
+    {
+        return DEFAULT_MAX_FRAME_AGE;
+    }
+    else
+    {
+        return ui->maxFrameAgeEdit->text().toInt();
+    }
+}
+
+int CameraConnectDialog::getCaptureDecimation()
+{
+    // Set decimation to default if field is blank
+    if(ui->captureDecimationEdit->text().isEmpty())
+    {
+        return DEFAULT_CAPTURE_DECIMATION;
+    }
+    else
+    {
+        return ui->captureDecimationEdit->text().toInt();
+    }
+}
+
+double CameraConnectDialog::getCaptureTargetFps()
+{
+    // Set target frame rate to default if field is blank
+    if(ui->captureTargetFpsEdit->text().isEmpty())
+    {
+        return DEFAULT_CAPTURE_TARGET_FPS;
+    }
+    else
+    {
+        return ui->captureTargetFpsEdit->text().toDouble();
+    }
+}
+
+int CameraConnectDialog::getBackPressureMode()
+{
+    return ui->backPressureComboBox->currentIndex();
+}
+
+int CameraConnectDialog::getCaptureFourcc()
+{
+    switch(ui->pixelFormatComboBox->currentIndex())
+    {
+        case 1:
+            return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+        case 2:
+            return cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V');
+        case 3:
+            return cv::VideoWriter::fourcc('G', 'R', 'E', 'Y');
+        default:
+            return 0;
+    }
+}
+
+bool CameraConnectDialog::getDeferColorConversionCheckBoxState()
+{
+    return ui->deferColorConversionCheckBox->isChecked();
+}
+
+bool CameraConnectDialog::getCaptureGrayscaleCheckBoxState()
+{
+    return ui->captureGrayscaleCheckBox->isChecked();
+}
+
+ThreadSchedulingData CameraConnectDialog::getCaptureThreadScheduling()
+{
+    ThreadSchedulingData schedulingData;
+    schedulingData.cpus = parseCpuList(ui->captureCpusEdit->text());
+    schedulingData.policy = ui->schedulingPolicyComboBox->currentIndex();
+    schedulingData.priority = getSchedulingPriority();
+    return schedulingData;
+}
+
+ThreadSchedulingData CameraConnectDialog::getProcessingThreadScheduling()
+{
+    ThreadSchedulingData schedulingData;
+    schedulingData.cpus = parseCpuList(ui->processingCpusEdit->text());
+    schedulingData.policy = ui->schedulingPolicyComboBox->currentIndex();
+    schedulingData.priority = getSchedulingPriority();
+    return schedulingData;
+}
+
+int CameraConnectDialog::getSchedulingPriority()
+{
+    // Set real-time priority to default if field is blank
+    if(ui->schedulingPriorityEdit->text().isEmpty())
+    {
+        return DEFAULT_THREAD_SCHEDULING_PRIORITY;
+    }
+    else
+    {
+        return ui->schedulingPriorityEdit->text().toInt();
+    }
+}
+
+bool CameraConnectDialog::getAutoPlaceThreadsCheckBoxState()
+{
+    return ui->autoPlaceThreadsCheckBox->isChecked();
+}
+
+bool CameraConnectDialog::getTestPatternCheckBoxState()
+{
+    return ui->testPatternCheckBox->isChecked();
+}
+
 int CameraConnectDialog::getCaptureThreadPrio()
 {
     return ui->capturePrioComboBox->currentIndex();
@@ -164,10 +392,35 @@ bool CameraConnectDialog::getEnableFrameProcessingCheckBoxState()
     return ui->enableFrameProcessingCheckBox->isChecked();
 }
 
+bool CameraConnectDialog::getAdaptiveQualityCheckBoxState()
+{
+    return ui->adaptiveQualityCheckBox->isChecked();
+}
+
+StreamOptions CameraConnectDialog::getStreamOptions()
+{
+    StreamOptions streamOptions;
+    streamOptions.enableAdaptiveQuality = getAdaptiveQualityCheckBoxState();
+    streamOptions.processingDeadline = getProcessingDeadline();
+    streamOptions.maxFrameAge = getMaxFrameAge();
+    streamOptions.backPressureMode = getBackPressureMode();
+    streamOptions.captureDecimation = getCaptureDecimation();
+    streamOptions.captureTargetFps = getCaptureTargetFps();
+    streamOptions.captureFourcc = getCaptureFourcc();
+    streamOptions.deferColorConversion = getDeferColorConversionCheckBoxState();
+    streamOptions.captureGrayscale = getCaptureGrayscaleCheckBoxState();
+    streamOptions.captureScheduling = getCaptureThreadScheduling();
+    streamOptions.processingScheduling = getProcessingThreadScheduling();
+    streamOptions.autoPlaceThreads = getAutoPlaceThreadsCheckBoxState();
+    streamOptions.testPattern = getTestPatternCheckBoxState();
+    return streamOptions;
+}
+
 void CameraConnectDialog::resetToDefaults()
 {
     // Default camera
     ui->deviceNumberEdit->clear();
+    ui->testPatternCheckBox->setChecked(false);
     // Resolution
     ui->resWEdit->clear();
     ui->resHEdit->clear();
@@ -175,6 +428,26 @@ void CameraConnectDialog::resetToDefaults()
     ui->imageBufferSizeEdit->setText(QString::number(DEFAULT_IMAGE_BUFFER_SIZE));
     // Drop frames
     ui->dropFrameCheckBox->setChecked(DEFAULT_DROP_FRAMES);
+    // Back-pressure
+    ui->backPressureComboBox->setCurrentIndex(DEFAULT_BACK_PRESSURE_MODE);
+    // Capture decimation
+    ui->captureDecimationEdit->setText(QString::number(DEFAULT_CAPTURE_DECIMATION));
+    ui->captureTargetFpsEdit->setText(QString::number(DEFAULT_CAPTURE_TARGET_FPS));
+    // Pixel format
+    ui->pixelFormatComboBox->setCurrentIndex(DEFAULT_CAPTURE_FOURCC);
+    ui->deferColorConversionCheckBox->setChecked(DEFAULT_DEFER_COLOR_CONVERSION);
+    ui->captureGrayscaleCheckBox->setChecked(DEFAULT_CAPTURE_GRAYSCALE);
+    // Buffer compression
+    ui->compressBufferCheckBox->setChecked(DEFAULT_BUFFER_COMPRESSION);
+    ui->compressRawFramesEdit->setText(QString::number(DEFAULT_BUFFER_COMPRESSION_RAW_FRAMES));
+    ui->compressQualityEdit->setText(QString::number(DEFAULT_BUFFER_COMPRESSION_QUALITY));
+    // Frame memory budget
+    ui->memoryShareEdit->setText(QString::number(DEFAULT_FRAME_MEMORY_SHARE));
+    ui->memoryPolicyComboBox->setCurrentIndex(DEFAULT_FRAME_MEMORY_POLICY);
+    // Processing deadline
+    ui->processingDeadlineEdit->setText(QString::number(DEFAULT_PROCESSING_DEADLINE));
+    // Maximum frame age
+    ui->maxFrameAgeEdit->setText(QString::number(DEFAULT_MAX_FRAME_AGE));
     // Capture thread
     if(DEFAULT_CAP_THREAD_PRIO == QThread::IdlePriority)
     {
@@ -241,8 +514,16 @@ void CameraConnectDialog::resetToDefaults()
     {
         ui->processingPrioComboBox->setCurrentIndex(7);
     }
+    // Thread placement and scheduling
+    ui->captureCpusEdit->clear();
+    ui->processingCpusEdit->clear();
+    ui->autoPlaceThreadsCheckBox->setChecked(DEFAULT_AUTO_PLACE_THREADS);
+    ui->schedulingPolicyComboBox->setCurrentIndex(DEFAULT_THREAD_SCHEDULING_POLICY);
+    ui->schedulingPriorityEdit->setText(QString::number(DEFAULT_THREAD_SCHEDULING_PRIORITY));
     // Tab label
     ui->tabLabelEdit->setText("");
     // Enable Frame Processing checkbox
     ui->enableFrameProcessingCheckBox->setChecked(true);
+    // Adaptive quality checkbox
+    ui->adaptiveQualityCheckBox->setChecked(DEFAULT_ADAPTIVE_QUALITY);
 }
@@ -35,6 +35,8 @@
 
 #include <QDialog>
 
+#include "Structures.h"
+
 namespace Ui {
 class CameraConnectDialog;
 }
@@ -53,10 +55,30 @@ class CameraConnectDialog : public QDialog
         int getResolutionHeight();
         int getImageBufferSize();
         bool getDropFrameCheckBoxState();
+        bool getBufferCompressionCheckBoxState();
+        int getBufferCompressionRawFrames();
+        int getBufferCompressionQuality();
+        int getFrameMemoryShare();
+        int getFrameMemoryPolicy();
+        int getProcessingDeadline();
+        int getMaxFrameAge();
+        int getCaptureDecimation();
+        double getCaptureTargetFps();
+        int getBackPressureMode();
+        int getCaptureFourcc();
+        bool getDeferColorConversionCheckBoxState();
+        bool getCaptureGrayscaleCheckBoxState();
+        ThreadSchedulingData getCaptureThreadScheduling();
+        ThreadSchedulingData getProcessingThreadScheduling();
+        int getSchedulingPriority();
+        bool getAutoPlaceThreadsCheckBoxState();
+        bool getTestPatternCheckBoxState();
         int getCaptureThreadPrio();
         int getProcessingThreadPrio();
         QString getTabLabel();
         bool getEnableFrameProcessingCheckBoxState();
+        bool getAdaptiveQualityCheckBoxState();
+        StreamOptions getStreamOptions();
 
     private:
         Ui::CameraConnectDialog *ui;
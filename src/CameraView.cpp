@@ -37,15 +37,34 @@
 #include "ProcessingThread.h"
 #include "ImageProcessingSettingsDialog.h"
 #include "SharedImageBuffer.h"
+#include "HttpServer.h"
+#include "ImageEncoderPool.h"
+#include "StreamMetrics.h"
+#include "ThreadScheduling.h"
+#include "SyntheticFrameSource.h"
+#include "LatencyBarcode.h"
+#include "Timestamp.h"
+#include "Config.h"
 
 #include <QMessageBox>
 #include <QDebug>
 #include <QMenu>
+#include <QFile>
+#include <QFileInfo>
+#include <QFileDialog>
+#include <QDateTime>
+#include <QTextStream>
 
-CameraView::CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, QWidget *parent) :
+#include <algorithm>
+
+CameraView::CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, HttpServer *httpServer, ImageEncoderPool *imageEncoderPool,
+                       MetricsRegistry *metricsRegistry, QWidget *parent) :
     QWidget(parent),
     ui(new Ui::CameraView),
-    m_sharedImageBuffer(sharedImageBuffer)
+    m_sharedImageBuffer(sharedImageBuffer),
+    m_httpServer(httpServer),
+    m_imageEncoderPool(imageEncoderPool),
+    m_metricsRegistry(metricsRegistry)
 {
     // Setup UI
     ui->setupUi(this);
@@ -53,6 +72,9 @@ CameraView::CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, Q
     m_deviceNumber = deviceNumber;
     // Initialize internal flag
     m_isCameraConnected = false;
+    m_qualityLevel = 0;
+    m_isTestPattern = false;
+    m_nFramesNotDisplayed = 0;
     // Set initial GUI state
     ui->frameLabel->setText(tr("No camera connected."));
     ui->imageBufferBar->setValue(0);
@@ -63,7 +85,10 @@ CameraView::CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, Q
     ui->cameraResolutionLabel->setText("");
     ui->roiLabel->setText("");
     ui->mouseCursorPosLabel->setText("");
+    ui->latencyLabel->setText("");
     ui->clearImageBufferButton->setDisabled(true);
+    // Performance graphs are shown on request (context menu)
+    ui->performanceGraph->hide();
     // Initialize ImageProcessingFlags structure
     m_imageProcessingFlags.grayscaleOn = false;
     m_imageProcessingFlags.smoothOn = false;
@@ -75,8 +100,11 @@ CameraView::CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, Q
     connect(ui->frameLabel, &FrameLabel::onMouseMoveEvent, this, &CameraView::updateMouseCursorPosLabel);
     connect(ui->clearImageBufferButton, &QPushButton::released, this, &CameraView::clearImageBuffer);
     connect(ui->frameLabel->menu, &QMenu::triggered, this, &CameraView::handleContextMenuAction);
-    // Register type
+    connect(ui->frameLabel, &FrameLabel::newLatencyMeasurement, this, &CameraView::updateLatency);
+    // Register types
     qRegisterMetaType<ThreadStatisticsData>("ThreadStatisticsData");
+    qRegisterMetaType<QualityLevelChangeData>("QualityLevelChangeData");
+    qRegisterMetaType<LatencyMeasurementData>("LatencyMeasurementData");
 }
 
 CameraView::~CameraView()
@@ -100,8 +128,14 @@ CameraView::~CameraView()
             m_sharedImageBuffer->setSyncEnabled(true);
         }
 
-        // Remove from shared buffer
+        // Remove from shared buffer and delete buffer (no longer accessed by capture/processing threads)
+        Buffer<cv::Mat> *imageBuffer = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber);
         m_sharedImageBuffer->removeByDeviceNumber(m_deviceNumber);
+        delete imageBuffer;
+        // Remove from HTTP server
+        m_httpServer->removeStream(m_deviceNumber);
+        // Remove metrics (threads have stopped updating them)
+        m_metricsRegistry->removeStream(m_deviceNumber);
         // Disconnect camera
         if (m_captureThread->disconnectCamera())
         {
@@ -116,7 +150,7 @@ CameraView::~CameraView()
     delete ui;
 }
 
-bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio, int procThreadPrio, bool enableFrameProcessing, int width, int height)
+bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio, int procThreadPrio, bool enableFrameProcessing, int width, int height, StreamOptions streamOptions)
 {
     // Set frame label text
     if (m_sharedImageBuffer->isSyncEnabledForDeviceNumber(m_deviceNumber))
@@ -130,6 +164,16 @@ bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio,
 
     // Create capture thread
     m_captureThread = new CaptureThread(m_sharedImageBuffer, m_deviceNumber, dropFrameIfBufferFull, width, height);
+    m_captureThread->setPixelFormat(streamOptions.captureFourcc, !streamOptions.deferColorConversion);
+    m_captureThread->setGrayscale(streamOptions.captureGrayscale);
+    // Test pattern: frames carry the time they were grabbed (decoded when displayed)
+    m_isTestPattern = streamOptions.testPattern;
+    if (m_isTestPattern)
+    {
+        SyntheticFrameSource *frameSource = new SyntheticFrameSource(SYNTHETIC_SOURCE_DEFAULT_FPS);
+        frameSource->setLatencyBarcodeEnabled(true);
+        m_captureThread->setFrameSource(frameSource);
+    }
     // Attempt to connect to camera
     if (m_captureThread->connectToCamera())
     {
@@ -139,8 +183,11 @@ bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio,
         m_imageProcessingSettingsDialog = new ImageProcessingSettingsDialog(this);
         // Setup signal/slot connections
         connect(m_processingThread, &ProcessingThread::newFrame, this, &CameraView::updateFrame);
+        // HTTP server only takes a reference to the frame: call directly from processing thread
+        connect(m_processingThread, &ProcessingThread::newProcessedFrame, m_httpServer, &HttpServer::updateFrame, Qt::DirectConnection);
         connect(m_processingThread, &ProcessingThread::updateStatisticsInGUI, this, &CameraView::updateProcessingThreadStats);
         connect(m_captureThread, &CaptureThread::updateStatisticsInGUI, this, &CameraView::updateCaptureThreadStats);
+        connect(m_processingThread, &ProcessingThread::qualityLevelChanged, this, &CameraView::updateQualityLevel);
         connect(m_imageProcessingSettingsDialog, &ImageProcessingSettingsDialog::newImageProcessingSettings, m_processingThread, &ProcessingThread::updateImageProcessingSettings);
         connect(this, &CameraView::newImageProcessingFlags, m_processingThread, &ProcessingThread::updateImageProcessingFlags);
         connect(this, &CameraView::setROI, m_processingThread, &ProcessingThread::setROI);
@@ -150,9 +197,30 @@ bool CameraView::connectToCamera(bool dropFrameIfBufferFull, int capThreadPrio,
             connect(ui->frameLabel, &FrameLabel::newMouseData, this, &CameraView::newMouseData);
         }
         // Set initial data in processing thread
+        m_processingThread->setInputSourceSize(m_captureThread->getInputSourceWidth(), m_captureThread->getInputSourceHeight());
         emit setROI(QRect(0, 0, m_captureThread->getInputSourceWidth(), m_captureThread->getInputSourceHeight()));
         emit newImageProcessingFlags(m_imageProcessingFlags);
         m_imageProcessingSettingsDialog->updateStoredSettingsFromDialog();
+        m_processingThread->setAdaptiveQualityEnabled(streamOptions.enableAdaptiveQuality);
+        m_processingThread->setProcessingDeadline(streamOptions.processingDeadline);
+        m_processingThread->setMaxFrameAge(streamOptions.maxFrameAge);
+        m_processingThread->setRawFormat(m_captureThread->getRawFormat());
+        ui->performanceGraph->setSources(m_captureThread->getPerformanceRing(), m_processingThread->getPerformanceRing(),
+                                         m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->maxSize());
+        m_captureThread->setBackPressureMode((CaptureThread::BackPressureMode)streamOptions.backPressureMode);
+        m_captureThread->setFrameDecimation(streamOptions.captureDecimation, streamOptions.captureTargetFps);
+        // Thread placement: auto-placement pins both threads of this stream to CPUs sharing a cache
+        if (streamOptions.autoPlaceThreads)
+        {
+            streamOptions.captureScheduling.cpus = getAutoPlacementCpus(m_deviceNumber);
+            streamOptions.processingScheduling.cpus = streamOptions.captureScheduling.cpus;
+        }
+        m_captureThread->setScheduling(streamOptions.captureScheduling);
+        m_processingThread->setScheduling(streamOptions.processingScheduling);
+        // Metrics (exported by HTTP server)
+        StreamMetrics *streamMetrics = m_metricsRegistry->addStream(m_deviceNumber);
+        m_captureThread->setMetrics(streamMetrics);
+        m_processingThread->setMetrics(streamMetrics);
 
         // Start capturing frames from camera
         m_captureThread->start((QThread::Priority)capThreadPrio);
@@ -217,14 +285,26 @@ void CameraView::updateCaptureThreadStats(ThreadStatisticsData statData)
 
     // Show processing rate in captureRateLabel
     ui->captureRateLabel->setText(QString::number(statData.averageFPS) + " fps");
+    // Show capture decimation (if reduced due to back-pressure)
+    if (statData.frameDecimation > 1)
+    {
+        ui->captureRateLabel->setText(ui->captureRateLabel->text() + QString(" [1/%1]").arg(statData.frameDecimation));
+    }
     // Show number of frames captured in nFramesCapturedLabel
     ui->nFramesCapturedLabel->setText(QString("[") + QString::number(statData.nFramesProcessed) + QString("]"));
+    // Show number of frames which were dropped (buffer full) in tooltip
+    ui->nFramesCapturedLabel->setToolTip(tr("Dropped (buffer full): %1").arg(statData.nFramesDropped));
 }
 
 void CameraView::updateProcessingThreadStats(ThreadStatisticsData statData)
 {
     // Show processing rate in processingRateLabel
     ui->processingRateLabel->setText(QString::number(statData.averageFPS) + " fps");
+    // Show quality level (if reduced by adaptive quality control)
+    if (m_qualityLevel > 0)
+    {
+        ui->processingRateLabel->setText(ui->processingRateLabel->text() + QString(" [Q-%1]").arg(m_qualityLevel));
+    }
     // Show ROI information in roiLabel
     ui->roiLabel->setText(QString("(") + QString::number(m_processingThread->getCurrentROI().x()) + QString(",") +
         QString::number(m_processingThread->getCurrentROI().y()) + QString(") ") +
@@ -232,14 +312,120 @@ void CameraView::updateProcessingThreadStats(ThreadStatisticsData statData)
         QString("x") + QString::number(m_processingThread->getCurrentROI().height()));
     // Show number of frames processed in nFramesProcessedLabel
     ui->nFramesProcessedLabel->setText(QString("[") + QString::number(statData.nFramesProcessed) + QString("]"));
+    // Show number of frames which were skipped or missed the processing deadline in tooltip
+    ui->nFramesProcessedLabel->setToolTip(tr("Skipped (older than max. age): %1\nSkipped (newer frame available): %2\nDiscarded (past deadline): %3\nDegraded (stages skipped): %4\nImages allocated (last frame): %5\nLatency (capture to processed): %6 ms").arg(statData.nFramesStale).arg(statData.nFramesSuperseded).arg(statData.nFramesLate).arg(statData.nFramesDegraded).arg(statData.nScratchAllocations).arg(statData.latency));
+    // Show latency up to end of processing (test pattern: latency up to display is shown instead)
+    if (!m_isTestPattern)
+    {
+        ui->latencyLabel->setText((statData.latency >= 0) ? QString::number(statData.latency) + " ms" : QString(""));
+        ui->latencyLabel->setToolTip(tr("Capture to end of processing (display not included)"));
+    }
+}
+
+void CameraView::updateQualityLevel(QualityLevelChangeData event)
+{
+    // Save current quality level (shown next to processing rate)
+    m_qualityLevel = event.level;
+    // Show recent level changes in tooltip
+    QStringList log;
+    foreach (const QualityLevelChangeData &change, m_processingThread->getQualityLevelChangeLog())
+    {
+        log << QString("%1: %2 -> %3 (buffer %4%, busy %5%)").arg(QDateTime::fromMSecsSinceEpoch(change.timestamp).toString("hh:mm:ss.zzz"))
+               .arg(change.previousLevel).arg(change.level).arg(qRound(change.bufferOccupancy * 100)).arg(qRound(change.utilization * 100));
+    }
+    ui->processingRateLabel->setToolTip(tr("Quality level (0 = full quality):") + "\n" + log.join("\n"));
 }
 
 void CameraView::updateFrame(const QImage &frame)
 {
+    // Test pattern: read time of capture from frame (measurement is completed when frame is painted)
+    if (m_isTestPattern)
+    {
+        LatencyMeasurementData latencyMeasurement;
+        if (readLatencyBarcode(frame, &latencyMeasurement.captureTimestamp, &latencyMeasurement.sequenceNumber))
+        {
+            latencyMeasurement.receiveTimestamp = currentTimestamp();
+            latencyMeasurement.paintTimestamp = -1;
+            ui->frameLabel->setLatencyMeasurement(latencyMeasurement);
+        }
+    }
     // Display frame
     ui->frameLabel->setPixmap(QPixmap::fromImage(frame).scaled(ui->frameLabel->width(), ui->frameLabel->height(),Qt::KeepAspectRatio));
 }
 
+void CameraView::updateLatency(LatencyMeasurementData latencyMeasurement)
+{
+    // Frames not displayed since last measurement (lost by source, skipped, dropped or replaced before painting)
+    if (!m_latencyLog.isEmpty())
+    {
+        quint32 gap = (latencyMeasurement.sequenceNumber - m_latencyLog.last().sequenceNumber) & 0xFFFFFF;
+        if (gap > 1)
+        {
+            m_nFramesNotDisplayed += gap - 1;
+        }
+    }
+    // Save measurement
+    m_latencyLog.append(latencyMeasurement);
+    if (m_latencyLog.size() > LATENCY_LOG_LENGTH)
+    {
+        m_latencyLog.removeFirst();
+    }
+    // Percentiles of recent measurements: capture to painted (glass-to-glass) and received to painted (GUI)
+    QVector<qint64> totalLatencies;
+    QVector<qint64> guiLatencies;
+    totalLatencies.reserve(m_latencyLog.size());
+    guiLatencies.reserve(m_latencyLog.size());
+    foreach (const LatencyMeasurementData &measurement, m_latencyLog)
+    {
+        totalLatencies.append(measurement.paintTimestamp - measurement.captureTimestamp);
+        guiLatencies.append(measurement.paintTimestamp - measurement.receiveTimestamp);
+    }
+    std::sort(totalLatencies.begin(), totalLatencies.end());
+    std::sort(guiLatencies.begin(), guiLatencies.end());
+    int p50 = (totalLatencies.size() - 1) / 2;
+    int p99 = (totalLatencies.size() - 1) * 99 / 100;
+    // Show latency of last frame in latencyLabel
+    ui->latencyLabel->setText(QString::number(latencyMeasurement.paintTimestamp - latencyMeasurement.captureTimestamp) + " ms");
+    ui->latencyLabel->setToolTip(tr("Capture to painted (last %1 frames): median %2 ms, p99 %3 ms, max %4 ms\n"
+                                    "Received by GUI to painted: median %5 ms, p99 %6 ms, max %7 ms\n"
+                                    "Frames not displayed: %8")
+                                 .arg(m_latencyLog.size()).arg(totalLatencies.at(p50)).arg(totalLatencies.at(p99)).arg(totalLatencies.last())
+                                 .arg(guiLatencies.at(p50)).arg(guiLatencies.at(p99)).arg(guiLatencies.last()).arg(m_nFramesNotDisplayed));
+}
+
+void CameraView::saveLatencyLog()
+{
+    if (m_latencyLog.isEmpty())
+    {
+        QMessageBox::warning(this, tr("Save Latency Log"), tr("No latency measurements available (connect with test pattern)."));
+        return;
+    }
+    // Prompt user for file name
+    QString defaultFileName = QString("latency_%1_%2.csv").arg(m_deviceNumber).arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Latency Log"), defaultFileName, tr("CSV files (*.csv)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    // One line per displayed frame (times in ms, relative to capture of first frame): e.g. for plotting
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+    {
+        QMessageBox::warning(this, tr("Save Latency Log"), tr("Could not write file."));
+        return;
+    }
+    QTextStream out(&file);
+    out << "sequence_number,capture_time,receive_time,paint_time,latency\n";
+    qint64 startTime = m_latencyLog.first().captureTimestamp;
+    foreach (const LatencyMeasurementData &measurement, m_latencyLog)
+    {
+        out << measurement.sequenceNumber << "," << (measurement.captureTimestamp - startTime) << ","
+            << (measurement.receiveTimestamp - startTime) << "," << (measurement.paintTimestamp - startTime) << ","
+            << (measurement.paintTimestamp - measurement.captureTimestamp) << "\n";
+    }
+    qDebug() << "[" << m_deviceNumber << "] Latency log saved:" << fileName;
+}
+
 void CameraView::clearImageBuffer()
 {
     if (m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->clear())
@@ -252,6 +438,60 @@ void CameraView::clearImageBuffer()
     }
 }
 
+void CameraView::saveSnapshot()
+{
+    // Get reference to latest processed frame
+    cv::Mat frame;
+    if (m_isCameraConnected)
+    {
+        frame = m_processingThread->getLastProcessedFrame();
+    }
+    if (frame.empty())
+    {
+        QMessageBox::warning(this, tr("Save Snapshot"), tr("No processed frame available."));
+        return;
+    }
+    // Prompt user for file name
+    QString defaultFileName = QString("snapshot_%1_%2.png").arg(m_deviceNumber).arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"));
+    QString fileName = QFileDialog::getSaveFileName(this, tr("Save Snapshot"), defaultFileName, tr("Images (*.png *.jpg *.jpeg *.bmp)"));
+    if (fileName.isEmpty())
+    {
+        return;
+    }
+    // Format is chosen by file extension (default: PNG)
+    QString suffix = QFileInfo(fileName).suffix().toLower();
+    if (suffix.isEmpty())
+    {
+        suffix = "png";
+        fileName += ".png";
+    }
+    std::vector<int> params;
+    if ((suffix == "jpg") || (suffix == "jpeg"))
+    {
+        params.push_back(cv::IMWRITE_JPEG_QUALITY);
+        params.push_back(SNAPSHOT_JPEG_QUALITY);
+    }
+    // Encode and write file in encoder pool
+    int deviceNumber = m_deviceNumber;
+    bool queued = m_imageEncoderPool->encode(frame, QString(".%1").arg(suffix).toStdString(), params,
+        [fileName, deviceNumber](bool success, const EncodedImage &image)
+        {
+            QFile file(fileName);
+            if (success && file.open(QIODevice::WriteOnly) && (file.write(image.data(), image.size()) == image.size()))
+            {
+                qDebug() << "[" << deviceNumber << "] Snapshot saved:" << fileName;
+            }
+            else
+            {
+                qDebug() << "[" << deviceNumber << "] WARNING: Could not save snapshot:" << fileName;
+            }
+        });
+    if (!queued)
+    {
+        QMessageBox::warning(this, tr("Save Snapshot"), tr("Image encoder is busy. Please try again."));
+    }
+}
+
 void CameraView::setImageProcessingSettings()
 {
     // Prompt user:
@@ -385,6 +625,18 @@ void CameraView::handleContextMenuAction(QAction *action)
     {
         ui->frameLabel->setScaledContents(action->isChecked());
     }
+    else if(action->text() == "Save Snapshot...")
+    {
+        saveSnapshot();
+    }
+    else if(action->text() == "Save Latency Log...")
+    {
+        saveLatencyLog();
+    }
+    else if(action->text() == "Performance Graphs")
+    {
+        ui->performanceGraph->setVisible(action->isChecked());
+    }
     else if(action->text() == "Grayscale")
     {
         m_imageProcessingFlags.grayscaleOn = action->isChecked();
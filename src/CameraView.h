@@ -45,25 +45,37 @@ class ProcessingThread;
 class CaptureThread;
 class SharedImageBuffer;
 class ImageProcessingSettingsDialog;
+class HttpServer;
+class ImageEncoderPool;
+class MetricsRegistry;
 
 class CameraView : public QWidget
 {
     Q_OBJECT
 
     public:
-        explicit CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, QWidget *parent = 0);
+        explicit CameraView(int deviceNumber, SharedImageBuffer *sharedImageBuffer, HttpServer *httpServer, ImageEncoderPool *imageEncoderPool,
+                            MetricsRegistry *metricsRegistry, QWidget *parent = 0);
         ~CameraView();
-        bool connectToCamera(bool dropFrame, int capThreadPrio, int procThreadPrio, bool createProcThread, int width, int height);
+        bool connectToCamera(bool dropFrame, int capThreadPrio, int procThreadPrio, bool createProcThread, int width, int height, StreamOptions streamOptions);
 
     private:
         void stopCaptureThread();
         void stopProcessingThread();
+        void saveLatencyLog();
         Ui::CameraView *ui;
         int m_deviceNumber;
         bool m_isCameraConnected;
+        int m_qualityLevel;
+        bool m_isTestPattern;
+        QList<LatencyMeasurementData> m_latencyLog;
+        int m_nFramesNotDisplayed;
         ProcessingThread *m_processingThread;
         CaptureThread *m_captureThread;
         SharedImageBuffer *m_sharedImageBuffer;
+        HttpServer *m_httpServer;
+        ImageEncoderPool *m_imageEncoderPool;
+        MetricsRegistry *m_metricsRegistry;
         ImageProcessingSettingsDialog *m_imageProcessingSettingsDialog;
         ImageProcessingFlags m_imageProcessingFlags;
 
@@ -72,11 +84,14 @@ class CameraView : public QWidget
         void newMouseData(MouseData mouseData);
         void updateMouseCursorPosLabel();
         void clearImageBuffer();
+        void saveSnapshot();
 
     private slots:
         void updateFrame(const QImage &frame);
         void updateProcessingThreadStats(ThreadStatisticsData statData);
         void updateCaptureThreadStats(ThreadStatisticsData statData);
+        void updateQualityLevel(QualityLevelChangeData event);
+        void updateLatency(LatencyMeasurementData latencyMeasurement);
         void handleContextMenuAction(QAction *action);
 
     signals:
@@ -33,13 +33,18 @@
 #include "CaptureThread.h"
 
 #include "SharedImageBuffer.h"
+#include "FrameSource.h"
+#include "StreamMetrics.h"
+#include "Timestamp.h"
+#include "ThreadScheduling.h"
 #include "Config.h"
 
 #include <QDebug>
 
 CaptureThread::CaptureThread(SharedImageBuffer *sharedImageBuffer, int deviceNumber, bool dropFrameIfBufferFull, int width, int height) :
     QThread(),
-    m_sharedImageBuffer(sharedImageBuffer)
+    m_sharedImageBuffer(sharedImageBuffer),
+    m_performanceRing(PERFORMANCE_RING_SIZE)
 {
     m_dropFrameIfBufferFull = dropFrameIfBufferFull;
     m_deviceNumber = deviceNumber;
@@ -51,10 +56,64 @@ CaptureThread::CaptureThread(SharedImageBuffer *sharedImageBuffer, int deviceNum
     m_fps.clear();
     m_statsData.averageFPS = 0;
     m_statsData.nFramesProcessed = 0;
+    m_statsData.nFramesStale = 0;
+    m_statsData.nFramesSuperseded = 0;
+    m_statsData.nFramesLate = 0;
+    m_statsData.nFramesDegraded = 0;
+    m_statsData.frameDecimation = 1;
+    m_statsData.nScratchAllocations = 0;
+    m_statsData.nFramesDropped = 0;
+    m_statsData.latency = -1;
+    m_backPressureMode = BackPressureOff;
+    m_backPressureDecimation = 1;
+    m_nFullBufferFrames = 0;
+    m_nEmptyBufferFrames = 0;
+    m_nFramesGrabbed = 0;
+    m_cameraFps = 0.0;
+    m_isCameraFpsLowered = false;
+    m_frameDecimation = 1;
+    m_targetFps = 0.0;
+    m_nFramesSinceKept = 0;
+    m_nextFrameTime = 0.0;
+    m_fourcc = 0;
+    m_rawFormat = 0;
+    m_convertToBgr = true;
+    m_grayscale = false;
+    m_schedulingData.policy = 0;
+    m_schedulingData.priority = 0;
+    // Camera with given device number (unless another source is set)
+    m_source = new CameraFrameSource(deviceNumber);
+    m_metrics = 0;
+}
+
+CaptureThread::~CaptureThread()
+{
+    delete m_source;
+}
+
+void CaptureThread::setFrameSource(FrameSource *frameSource)
+{
+    // Must be called before connectToCamera() (takes ownership of source)
+    delete m_source;
+    m_source = frameSource;
+}
+
+void CaptureThread::setMetrics(StreamMetrics *metrics)
+{
+    // Must be called before the thread is started (metrics must outlive the thread)
+    m_metrics = metrics;
 }
 
 void CaptureThread::run()
 {
+    // Set CPU affinity and scheduling policy of this thread
+    if (!applyThreadScheduling(m_schedulingData))
+    {
+        qDebug() << "[" << m_deviceNumber << "] WARNING: Could not apply thread scheduling settings.";
+    }
+    // Format of frames (published to shared memory with each frame)
+    m_rawFormat = getRawFormat();
+
     while(1)
     {
         ////////////////////////////////
@@ -80,19 +139,68 @@ void CaptureThread::run()
         m_sharedImageBuffer->sync(m_deviceNumber);
 
         // Capture frame (if available)
-        if (!m_cap.grab())
+        if (!m_source->grab())
+        {
+            continue;
+        }
+        // Save time of capture (used by consumers to determine age of frame)
+        qint64 timestamp = currentTimestamp();
+
+        // Decimation: frames which are not kept are grabbed (driver queue is drained) but not retrieved (decoded)
+        if (!keepFrame(timestamp))
+        {
+            continue;
+        }
+
+        // Retrieve frame (into a new Mat: frames still held by the buffer must not be overwritten)
+        m_grabbedFrame.release();
+        if (!m_source->retrieve(m_grabbedFrame) || m_grabbedFrame.empty())
         {
             continue;
         }
+        // Convert frame to luminance (frames are 1-channel from here on: buffer, publishing and processing)
+        if (m_grayscale)
+        {
+            convertToGrayscale(m_grabbedFrame);
+        }
+        // Publish frame to shared memory (if enabled for this stream)
+        m_sharedImageBuffer->publish(m_deviceNumber, m_grabbedFrame, m_rawFormat);
+        // Add frame to buffer (an empty buffer means that the consumer is waiting for frames)
+        Buffer<cv::Mat> *imageBuffer = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber);
+        bool isBufferEmpty = imageBuffer->isEmpty();
+        bool isAdded = imageBuffer->add(m_grabbedFrame, m_dropFrameIfBufferFull, timestamp);
+        if (!isAdded)
+        {
+            m_statsData.nFramesDropped++;
+        }
+        // Consumer is not keeping up if the frame was dropped or older frames are still waiting in the full buffer (a
+        // consumer busy with the previous frame of a single-frame buffer is keeping up)
+        bool isBufferFull = !isAdded || ((imageBuffer->maxSize() > 1) && imageBuffer->isFull());
+        // Older frames dropped from buffer to make room in frame memory budget
+        m_statsData.nFramesDropped += imageBuffer->takeEvictedItemCount();
+        // Adjust capture rate
+        if (m_backPressureMode != BackPressureOff)
+        {
+            updateBackPressure(isBufferFull, isBufferEmpty);
+        }
 
-        // Retrieve frame
-        m_cap.retrieve(m_grabbedFrame);
-        // Add frame to buffer
-        m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->add(m_grabbedFrame, m_dropFrameIfBufferFull);
+        // Record sample for performance graphs (lock-free: read by GUI thread at a low rate)
+        PerformanceSample performanceSample = PerformanceSample();
+        performanceSample.timestamp = timestamp;
+        performanceSample.captureInterval = m_frameIntervalTimer.isValid() ? m_frameIntervalTimer.nsecsElapsed() / 1000000.0f : 0.0f;
+        performanceSample.bufferOccupancy = imageBuffer->size();
+        performanceSample.nFramesDropped = m_statsData.nFramesDropped;
+        m_performanceRing.push(performanceSample);
+        m_frameIntervalTimer.start();
 
         // Update statistics
         updateFPS(m_captureTime);
         m_statsData.nFramesProcessed++;
+        // Export metrics (if enabled)
+        if (m_metrics != 0)
+        {
+            m_metrics->updateCapture(m_statsData, performanceSample, imageBuffer->maxSize());
+        }
         // Inform GUI of updated statistics
         emit updateStatisticsInGUI(m_statsData);
     }
@@ -103,16 +211,32 @@ void CaptureThread::run()
 bool CaptureThread::connectToCamera()
 {
     // Open camera
-    bool camOpenResult = m_cap.open(m_deviceNumber);
+    bool camOpenResult = m_source->open();
+    // Set pixel format (before resolution: changing the format may reset the resolution)
+    if (m_fourcc != 0)
+    {
+        m_source->set(CV_CAP_PROP_FOURCC, m_fourcc);
+    }
+    // Deliver frames in raw format (conversion to BGR is done by the processing thread)
+    if (!m_convertToBgr)
+    {
+        if (!m_source->set(CV_CAP_PROP_CONVERT_RGB, 0))
+        {
+            qDebug() << "[" << m_deviceNumber << "] WARNING: Camera does not support raw frames, frames are converted to BGR.";
+            m_convertToBgr = true;
+        }
+    }
     // Set resolution
     if (m_width != -1)
     {
-        m_cap.set(CV_CAP_PROP_FRAME_WIDTH, m_width);
+        m_source->set(CV_CAP_PROP_FRAME_WIDTH, m_width);
     }
     if (m_height != -1)
     {
-        m_cap.set(CV_CAP_PROP_FRAME_HEIGHT, m_height);
+        m_source->set(CV_CAP_PROP_FRAME_HEIGHT, m_height);
     }
+    // Save frame rate of camera (used to lower frame rate under back-pressure, 0 if unknown)
+    m_cameraFps = m_source->get(CV_CAP_PROP_FPS);
     // Return result
     return camOpenResult;
 }
@@ -120,10 +244,10 @@ bool CaptureThread::connectToCamera()
 bool CaptureThread::disconnectCamera()
 {
     // Camera is connected
-    if (m_cap.isOpened())
+    if (m_source->isOpened())
     {
         // Disconnect camera
-        m_cap.release();
+        m_source->release();
         return true;
     }
     // Camera is NOT connected
@@ -164,6 +288,147 @@ void CaptureThread::updateFPS(int timeElapsed)
     }
 }
 
+bool CaptureThread::keepFrame(qint64 timestamp)
+{
+    // Keep 1 of N frames
+    if (++m_nFramesSinceKept < m_frameDecimation)
+    {
+        return false;
+    }
+    m_nFramesSinceKept = 0;
+
+    // Keep at most target fps frames per second
+    if (m_targetFps > 0.0)
+    {
+        // Allow frame to arrive up to half a camera frame period early (camera timing jitter)
+        double tolerance = (m_cameraFps > 0.0) ? 500.0 / m_cameraFps : 0.0;
+        if ((double)timestamp < m_nextFrameTime - tolerance)
+        {
+            return false;
+        }
+        // Schedule next frame (do not try to catch up if more than one frame period behind)
+        m_nextFrameTime = qMax(m_nextFrameTime + 1000.0 / m_targetFps, (double)timestamp);
+    }
+
+    // Back-pressure: keep 1 of N of the remaining frames (unless the camera itself delivers fewer frames)
+    if (!m_isCameraFpsLowered && (++m_nFramesGrabbed < m_backPressureDecimation))
+    {
+        return false;
+    }
+    m_nFramesGrabbed = 0;
+    return true;
+}
+
+void CaptureThread::setFrameDecimation(int decimation, double targetFps)
+{
+    m_frameDecimation = qMax(decimation, 1);
+    m_targetFps = targetFps;
+    m_nFramesSinceKept = 0;
+    m_nextFrameTime = 0.0;
+}
+
+void CaptureThread::setPixelFormat(int fourcc, bool convertToBgr)
+{
+    // Must be called before connectToCamera()
+    m_fourcc = fourcc;
+    m_convertToBgr = convertToBgr;
+}
+
+int CaptureThread::getRawFormat()
+{
+    // Frames are converted to BGR by OpenCV or to grayscale by capture thread
+    if (m_convertToBgr || m_grayscale)
+    {
+        return 0;
+    }
+    // Pixel format actually selected by camera
+    return (int)m_source->get(CV_CAP_PROP_FOURCC);
+}
+
+void CaptureThread::setGrayscale(bool grayscale)
+{
+    // Must be called before start()
+    m_grayscale = grayscale;
+}
+
+void CaptureThread::setScheduling(const ThreadSchedulingData &schedulingData)
+{
+    // Must be called before start()
+    m_schedulingData = schedulingData;
+}
+
+void CaptureThread::convertToGrayscale(cv::Mat &frame)
+{
+    cv::Mat grayFrame;
+    // Raw YUYV (YUV 4:2:2): luminance is channel 0
+    if (frame.channels() == 2)
+    {
+        cv::extractChannel(frame, grayFrame, 0);
+    }
+    // Raw Motion JPEG (single row): decode luminance only
+    else if ((frame.rows == 1) && (frame.type() == CV_8UC1))
+    {
+        grayFrame = cv::imdecode(frame, cv::IMREAD_GRAYSCALE);
+    }
+    else if (frame.channels() == 3)
+    {
+        cv::cvtColor(frame, grayFrame, CV_BGR2GRAY);
+    }
+    else if (frame.channels() == 4)
+    {
+        cv::cvtColor(frame, grayFrame, CV_BGRA2GRAY);
+    }
+    // Frame is already grayscale (e.g. GREY pixel format) or could not be converted
+    if (!grayFrame.empty())
+    {
+        frame = grayFrame;
+    }
+}
+
+void CaptureThread::setBackPressureMode(BackPressureMode mode)
+{
+    m_backPressureMode = mode;
+}
+
+void CaptureThread::updateBackPressure(bool isBufferFull, bool isBufferEmpty)
+{
+    // Count consecutive frames for which the buffer was full/empty
+    m_nFullBufferFrames = isBufferFull ? m_nFullBufferFrames + 1 : 0;
+    m_nEmptyBufferFrames = isBufferEmpty ? m_nEmptyBufferFrames + 1 : 0;
+
+    // Sustained back-pressure: halve capture rate
+    if ((m_nFullBufferFrames >= BACK_PRESSURE_STEP_DOWN_FRAMES) && (m_backPressureDecimation < BACK_PRESSURE_MAX_DECIMATION))
+    {
+        setBackPressureDecimation(m_backPressureDecimation * 2);
+    }
+    // Consumer has caught up: double capture rate
+    else if ((m_nEmptyBufferFrames >= BACK_PRESSURE_STEP_UP_FRAMES) && (m_backPressureDecimation > 1))
+    {
+        setBackPressureDecimation(m_backPressureDecimation / 2);
+    }
+}
+
+void CaptureThread::setBackPressureDecimation(int decimation)
+{
+    qDebug() << "[" << m_deviceNumber << "] Back-pressure: capturing 1 of" << decimation << "frames.";
+    m_backPressureDecimation = decimation;
+    m_nFullBufferFrames = 0;
+    m_nEmptyBufferFrames = 0;
+    m_nFramesGrabbed = 0;
+    m_statsData.frameDecimation = decimation;
+
+    // Lower frame rate of camera (falls back to skipping decode of frames if the camera does not support this)
+    if ((m_backPressureMode == BackPressureLowerCameraFps) && (m_cameraFps > 0.0))
+    {
+        m_isCameraFpsLowered = m_source->set(CV_CAP_PROP_FPS, m_cameraFps / decimation);
+        if (!m_isCameraFpsLowered)
+        {
+            qDebug() << "[" << m_deviceNumber << "] Back-pressure: camera frame rate cannot be set, skipping decode of frames instead.";
+            m_backPressureMode = BackPressureSkipDecode;
+        }
+    }
+}
+
 void CaptureThread::stop()
 {
     QMutexLocker locker(&m_doStopMutex);
@@ -172,15 +437,20 @@ void CaptureThread::stop()
 
 bool CaptureThread::isCameraConnected()
 {
-    return m_cap.isOpened();
+    return m_source->isOpened();
 }
 
 int CaptureThread::getInputSourceWidth()
 {
-    return m_cap.get(CV_CAP_PROP_FRAME_WIDTH);
+    return m_source->get(CV_CAP_PROP_FRAME_WIDTH);
 }
 
 int CaptureThread::getInputSourceHeight()
 {
-    return m_cap.get(CV_CAP_PROP_FRAME_HEIGHT);
+    return m_source->get(CV_CAP_PROP_FRAME_HEIGHT);
+}
+
+const StatsRing<PerformanceSample> *CaptureThread::getPerformanceRing()
+{
+    return &m_performanceRing;
 }
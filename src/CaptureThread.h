@@ -35,36 +35,64 @@
 
 #include <QThread>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QQueue>
 
 #include <opencv2/opencv.hpp>
 
 #include "Structures.h"
+#include "StatsRing.h"
 
 class SharedImageBuffer;
+class FrameSource;
+class StreamMetrics;
 
 class CaptureThread : public QThread
 {
     Q_OBJECT
 
     public:
+        // Reaction to a consumer which cannot keep up
+        enum BackPressureMode
+        {
+            BackPressureOff = 0,
+            BackPressureSkipDecode = 1,
+            BackPressureLowerCameraFps = 2
+        };
         CaptureThread(SharedImageBuffer *sharedImageBuffer, int deviceNumber, bool dropFrameIfBufferFull, int width, int height);
+        ~CaptureThread();
+        void setFrameSource(FrameSource *frameSource);
+        void setFrameDecimation(int decimation, double targetFps);
+        void setPixelFormat(int fourcc, bool convertToBgr);
+        int getRawFormat();
+        void setGrayscale(bool grayscale);
+        void setScheduling(const ThreadSchedulingData &schedulingData);
+        void setBackPressureMode(BackPressureMode mode);
+        void setMetrics(StreamMetrics *metrics);
         void stop();
         bool connectToCamera();
         bool disconnectCamera();
         bool isCameraConnected();
         int getInputSourceWidth();
         int getInputSourceHeight();
+        const StatsRing<PerformanceSample> *getPerformanceRing();
 
     private:
         void updateFPS(int);
+        bool keepFrame(qint64 timestamp);
+        void updateBackPressure(bool isBufferFull, bool isBufferEmpty);
+        void setBackPressureDecimation(int decimation);
+        void convertToGrayscale(cv::Mat &frame);
         SharedImageBuffer *m_sharedImageBuffer;
-        cv::VideoCapture m_cap;
+        FrameSource *m_source;
+        StreamMetrics *m_metrics;
         cv::Mat m_grabbedFrame;
         QTime m_t;
         QMutex m_doStopMutex;
         QQueue<int> m_fps;
         ThreadStatisticsData m_statsData;
+        StatsRing<PerformanceSample> m_performanceRing;
+        QElapsedTimer m_frameIntervalTimer;
         volatile bool m_doStop;
         int m_captureTime;
         int m_sampleNumber;
@@ -73,6 +101,22 @@ class CaptureThread : public QThread
         int m_deviceNumber;
         int m_width;
         int m_height;
+        BackPressureMode m_backPressureMode;
+        int m_backPressureDecimation;
+        int m_nFullBufferFrames;
+        int m_nEmptyBufferFrames;
+        int m_nFramesGrabbed;
+        double m_cameraFps;
+        bool m_isCameraFpsLowered;
+        int m_frameDecimation;
+        double m_targetFps;
+        int m_nFramesSinceKept;
+        double m_nextFrameTime;
+        int m_fourcc;
+        int m_rawFormat; // FOURCC of frames added to buffer (0: BGR or grayscale)
+        bool m_convertToBgr;
+        bool m_grayscale;
+        ThreadSchedulingData m_schedulingData;
 
     protected:
         void run();
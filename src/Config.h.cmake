@@ -50,9 +50,84 @@ namespace {
 #define DEFAULT_IMAGE_BUFFER_SIZE           1
 // Drop frame if image/frame buffer is full
 #define DEFAULT_DROP_FRAMES                 false
+// Compress frames stored beyond the first N frames of the image/frame buffer (0: lossless, 1-100: JPEG quality)
+#define DEFAULT_BUFFER_COMPRESSION          false
+#define DEFAULT_BUFFER_COMPRESSION_RAW_FRAMES 8
+#define DEFAULT_BUFFER_COMPRESSION_QUALITY  90
+// Frame memory budget shared by the image buffers of all streams
+#define DEFAULT_FRAME_MEMORY_BUDGET_MB      0 // 0: unlimited
+#define DEFAULT_FRAME_MEMORY_SHARE          1
+#define DEFAULT_FRAME_MEMORY_POLICY         0 // Options: [DROP_OLDEST=0,DEGRADE_RESOLUTION=1,BLOCK=2]
+#define FRAME_MEMORY_BLOCK_TIMEOUT          1000 // ms (frame is dropped after timeout)
+// Shared memory frame bus (POSIX only)
+#define SHARED_MEMORY_FRAME_BUS_NAME_PREFIX "/qt-opencv-multithreaded-"
+#define SHARED_MEMORY_FRAME_BUS_SLOT_COUNT  8
+// Image encoder pool (JPEG/PNG output)
+#define IMAGE_ENCODER_THREADS               0 // 0: half of the available cores
+#define IMAGE_ENCODER_MAX_QUEUE_DEPTH       16
+#define IMAGE_ENCODER_MAX_FREE_BUFFERS      32
+#define SNAPSHOT_JPEG_QUALITY               95
+// HTTP server (MJPEG streams)
+#define HTTP_SERVER_ADDRESS                 "127.0.0.1" // Use "0.0.0.0" to listen on all interfaces
+#define HTTP_SERVER_PORT                    8080
+#define HTTP_SERVER_MAX_REQUEST_SIZE        8192
+#define MJPEG_BOUNDARY                      "mjpegframe"
+#define DEFAULT_MJPEG_QUALITY               80
+#define MJPEG_QUALITY_STEP                  10
+// Serve metrics of all streams at /metrics (Prometheus text format) while the HTTP server is running
+#define DEFAULT_HTTP_SERVER_METRICS         false
+// Processing stages which may be skipped under load (adaptive quality control, processing deadline)
+#define OPTIONAL_PROCESSING_STAGES          0x7 // Options: [SMOOTH=0x1,DILATE=0x2,ERODE=0x4,CANNY=0x8]
+// Processing deadline: frames must be processed within this time after capture
+#define DEFAULT_PROCESSING_DEADLINE         0 // ms (0: no deadline)
+#define PROCESSING_STAGE_TIME_SMOOTHING     0.2
+// Maximum age of frames taken from the image buffer for processing (older frames are skipped, newest frame is used)
+#define DEFAULT_MAX_FRAME_AGE               0 // ms (0: process all frames in order)
+// Processing stages render into images kept by the processing thread (see ScratchArena)
+#define SCRATCH_ARENA_MAX_MATS              8
+// Adaptive quality control (see AdaptiveQualityController)
+#define DEFAULT_ADAPTIVE_QUALITY            false
+#define ADAPTIVE_QUALITY_SMOOTHING          0.1
+#define ADAPTIVE_QUALITY_HIGH_OCCUPANCY     0.75
+#define ADAPTIVE_QUALITY_LOW_OCCUPANCY      0.25
+#define ADAPTIVE_QUALITY_HIGH_UTILIZATION   0.95
+#define ADAPTIVE_QUALITY_LOW_UTILIZATION    0.6
+#define ADAPTIVE_QUALITY_STEP_DOWN_SAMPLES  10
+#define ADAPTIVE_QUALITY_STEP_UP_SAMPLES    60
+#define ADAPTIVE_QUALITY_STEP_DOWN_HOLD_TIME 500 // ms
+#define ADAPTIVE_QUALITY_STEP_UP_HOLD_TIME  3000 // ms
+#define ADAPTIVE_QUALITY_EVENT_LOG_LENGTH   32
+// Capture pixel format
+#define DEFAULT_CAPTURE_FOURCC              0 // Options: [DEFAULT=0,MJPG=1,YUYV=2,GREY=3]
+#define DEFAULT_DEFER_COLOR_CONVERSION      false
+#define DEFAULT_CAPTURE_GRAYSCALE           false
+// Capture decimation: keep 1 of N frames and/or at most a target frame rate (other frames are not decoded)
+#define DEFAULT_CAPTURE_DECIMATION          1
+#define DEFAULT_CAPTURE_TARGET_FPS          0 // 0: no limit
+// Back-pressure: capture fewer frames while the image buffer stays full
+#define DEFAULT_BACK_PRESSURE_MODE          0 // Options: [OFF=0,SKIP_DECODE=1,LOWER_CAMERA_FPS=2]
+#define BACK_PRESSURE_MAX_DECIMATION        8
+#define BACK_PRESSURE_STEP_DOWN_FRAMES      15 // Consecutive frames with full buffer
+#define BACK_PRESSURE_STEP_UP_FRAMES        90 // Consecutive frames with empty buffer
+// Synthetic frame source (soak test): resolution unless set by capture thread
+#define SYNTHETIC_SOURCE_DEFAULT_WIDTH      640
+#define SYNTHETIC_SOURCE_DEFAULT_HEIGHT     480
+#define SYNTHETIC_SOURCE_ROWS_PER_FRAME     4
+#define SYNTHETIC_SOURCE_DEFAULT_FPS        30
+// Latency measurement: barcode written into frames of test pattern (see LatencyBarcode), measurements kept per stream
+#define LATENCY_BARCODE_CELL_SIZE           8 // pixels
+#define LATENCY_LOG_LENGTH                  3600
+// Performance graphs (CameraView): samples kept per thread (ring), time shown and repaint interval
+#define PERFORMANCE_RING_SIZE               4096
+#define PERFORMANCE_GRAPH_HISTORY           60 // s
+#define PERFORMANCE_GRAPH_UPDATE_INTERVAL   250 // ms
 // Thread priorities
 #define DEFAULT_CAP_THREAD_PRIO             QThread::NormalPriority
 #define DEFAULT_PROC_THREAD_PRIO            QThread::HighPriority
+// Thread placement and scheduling (Linux only)
+#define DEFAULT_AUTO_PLACE_THREADS          false
+#define DEFAULT_THREAD_SCHEDULING_POLICY    0 // Options: [DEFAULT=0,SCHED_FIFO=1,SCHED_RR=2]
+#define DEFAULT_THREAD_SCHEDULING_PRIORITY  10
 
 // IMAGE PROCESSING
 // Smooth
@@ -61,10 +136,15 @@ namespace {
 #define DEFAULT_SMOOTH_PARAM_2              3
 #define DEFAULT_SMOOTH_PARAM_3              0
 #define DEFAULT_SMOOTH_PARAM_4              0
+// Hand-vectorized grayscale conversion, box blur and flip (see SimdKernels): validated against OpenCV at startup
+#define SIMD_KERNELS_MODE                   1 // Options: [OFF=0,IF_FASTER_THAN_OPENCV=1,ALWAYS=2]
+#define SIMD_KERNELS_CALIBRATION_RUNS       10
 // Dilate
 #define DEFAULT_DILATE_ITERATIONS           1
 // Erode
 #define DEFAULT_ERODE_ITERATIONS            1
+// Dilate/erode: number of iterations from which a single van Herk/Gil-Werman pass is used instead of OpenCV
+#define MORPHOLOGY_VAN_HERK_MIN_ITERATIONS  3
 // Flip
 #define DEFAULT_FLIP_CODE                   0 // Options: [x-axis=0,y-axis=1,both axes=-1]
 // Canny
@@ -32,6 +32,8 @@
 
 #include "FrameLabel.h"
 
+#include "Timestamp.h"
+
 #include <QPainter>
 #include <QMouseEvent>
 #include <QRect>
@@ -47,6 +49,7 @@ FrameLabel::FrameLabel(QWidget *parent) :
     m_drawBox = false;
     m_mouseData.leftButtonRelease = false;
     m_mouseData.rightButtonRelease = false;
+    m_isLatencyMeasurementPending = false;
     createContextMenu();
 }
 
@@ -139,6 +142,20 @@ void FrameLabel::paintEvent(QPaintEvent *ev)
         painter.setPen(Qt::blue);
         painter.drawRect(*m_box);
     }
+    // Complete latency measurement of frame (only the last frame set before painting is shown)
+    if (m_isLatencyMeasurementPending)
+    {
+        m_latencyMeasurement.paintTimestamp = currentTimestamp();
+        m_isLatencyMeasurementPending = false;
+        emit newLatencyMeasurement(m_latencyMeasurement);
+    }
+}
+
+void FrameLabel::setLatencyMeasurement(const LatencyMeasurementData &latencyMeasurement)
+{
+    // Frame with this measurement is set next (completed when painted)
+    m_latencyMeasurement = latencyMeasurement;
+    m_isLatencyMeasurementPending = true;
 }
 
 void FrameLabel::createContextMenu()
@@ -154,6 +171,16 @@ void FrameLabel::createContextMenu()
     action->setText(tr("Scale to Fit Frame"));
     action->setCheckable(true);
     menu->addAction(action);
+    action = new QAction(this);
+    action->setText(tr("Save Snapshot..."));
+    menu->addAction(action);
+    action = new QAction(this);
+    action->setText(tr("Save Latency Log..."));
+    menu->addAction(action);
+    action = new QAction(this);
+    action->setText(tr("Performance Graphs"));
+    action->setCheckable(true);
+    menu->addAction(action);
     menu->addSeparator();
     // Create image processing menu object
     QMenu* menu_imgProc = new QMenu(this);
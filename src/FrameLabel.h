@@ -49,6 +49,7 @@ class FrameLabel : public QLabel
         FrameLabel(QWidget *parent = 0);
         void setMouseCursorPos(QPoint point);
         QPoint getMouseCursorPos();
+        void setLatencyMeasurement(const LatencyMeasurementData &latencyMeasurement);
         QMenu *menu;
 
     private:
@@ -58,6 +59,8 @@ class FrameLabel : public QLabel
         QPoint m_mouseCursorPos;
         bool m_drawBox;
         QRect *m_box;
+        LatencyMeasurementData m_latencyMeasurement;
+        bool m_isLatencyMeasurementPending;
 
     protected:
         void mouseMoveEvent(QMouseEvent *ev);
@@ -68,6 +71,7 @@ class FrameLabel : public QLabel
     signals:
         void newMouseData(MouseData mouseData);
         void onMouseMoveEvent();
+        void newLatencyMeasurement(LatencyMeasurementData latencyMeasurement);
 };
 
 #endif // FRAMELABEL_H
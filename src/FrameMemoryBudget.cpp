@@ -0,0 +1,183 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* FrameMemoryBudget.cpp                                                */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "FrameMemoryBudget.h"
+
+#include <QElapsedTimer>
+
+FrameMemoryBudget::FrameMemoryBudget(qint64 budget)
+{
+    m_budget = budget;
+    m_totalShares = 0;
+}
+
+void FrameMemoryBudget::setBudget(qint64 budget)
+{
+    QMutexLocker locker(&m_mutex);
+    m_budget = budget;
+    // Blocked streams may now fit
+    m_releasedCondition.wakeAll();
+}
+
+qint64 FrameMemoryBudget::getBudget()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_budget;
+}
+
+void FrameMemoryBudget::addStream(int deviceNumber, int share, Policy policy)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_streamMap.contains(deviceNumber))
+    {
+        m_totalShares -= m_streamMap[deviceNumber].share;
+    }
+    Stream stream;
+    stream.share = qMax(share, 1);
+    stream.policy = policy;
+    stream.usage = 0;
+    m_streamMap[deviceNumber] = stream;
+    m_totalShares += stream.share;
+}
+
+void FrameMemoryBudget::removeStream(int deviceNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_streamMap.contains(deviceNumber))
+    {
+        m_totalShares -= m_streamMap.take(deviceNumber).share;
+        // Remaining streams now have a larger part of the budget
+        m_releasedCondition.wakeAll();
+    }
+}
+
+bool FrameMemoryBudget::containsStream(int deviceNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamMap.contains(deviceNumber);
+}
+
+FrameMemoryBudget::Policy FrameMemoryBudget::getPolicy(int deviceNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamMap.value(deviceNumber).policy;
+}
+
+bool FrameMemoryBudget::tryAcquire(int deviceNumber, qint64 nBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    // Streams which are not part of the budget are not limited
+    if (!m_streamMap.contains(deviceNumber))
+    {
+        return true;
+    }
+    Stream &stream = m_streamMap[deviceNumber];
+    if (isAvailable(stream, nBytes))
+    {
+        stream.usage += nBytes;
+        return true;
+    }
+    return false;
+}
+
+bool FrameMemoryBudget::acquire(int deviceNumber, qint64 nBytes, int timeout)
+{
+    QElapsedTimer t;
+    t.start();
+
+    QMutexLocker locker(&m_mutex);
+    // Wait (at most timeout ms) for other frames of the stream to be released
+    while (m_streamMap.contains(deviceNumber))
+    {
+        Stream &stream = m_streamMap[deviceNumber];
+        if (isAvailable(stream, nBytes))
+        {
+            stream.usage += nBytes;
+            return true;
+        }
+        qint64 remaining = timeout - t.elapsed();
+        if ((remaining <= 0) || !m_releasedCondition.wait(&m_mutex, (unsigned long)remaining))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void FrameMemoryBudget::release(int deviceNumber, qint64 nBytes)
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_streamMap.contains(deviceNumber))
+    {
+        Stream &stream = m_streamMap[deviceNumber];
+        stream.usage = qMax(stream.usage - nBytes, (qint64)0);
+        m_releasedCondition.wakeAll();
+    }
+}
+
+qint64 FrameMemoryBudget::getLimit(int deviceNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamMap.contains(deviceNumber) ? limit(m_streamMap[deviceNumber]) : 0;
+}
+
+qint64 FrameMemoryBudget::getUsage(int deviceNumber)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_streamMap.value(deviceNumber).usage;
+}
+
+qint64 FrameMemoryBudget::getTotalUsage()
+{
+    QMutexLocker locker(&m_mutex);
+    qint64 totalUsage = 0;
+    foreach (const Stream &stream, m_streamMap)
+    {
+        totalUsage += stream.usage;
+    }
+    return totalUsage;
+}
+
+bool FrameMemoryBudget::isAvailable(const Stream &stream, qint64 nBytes) const
+{
+    // A stream may always hold at least one frame (otherwise it could never make progress)
+    return (m_budget <= 0) || (stream.usage == 0) || (stream.usage + nBytes <= limit(stream));
+}
+
+qint64 FrameMemoryBudget::limit(const Stream &stream) const
+{
+    if ((m_budget <= 0) || (m_totalShares == 0))
+    {
+        return 0;
+    }
+    return m_budget * stream.share / m_totalShares;
+}
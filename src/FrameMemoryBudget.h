@@ -0,0 +1,82 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* FrameMemoryBudget.h                                                  */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef FRAMEMEMORYBUDGET_H
+#define FRAMEMEMORYBUDGET_H
+
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Process-wide budget (in bytes) for frames held in image buffers. Each stream may hold up to
+// budget * share / (sum of shares of all streams). A budget of 0 means unlimited.
+class FrameMemoryBudget
+{
+    public:
+        // What a stream does when adding a frame would exceed its part of the budget
+        enum Policy
+        {
+            DropOldest = 0,
+            DegradeResolution = 1,
+            Block = 2
+        };
+        FrameMemoryBudget(qint64 budget = 0);
+        void setBudget(qint64 budget);
+        qint64 getBudget();
+        void addStream(int deviceNumber, int share, Policy policy);
+        void removeStream(int deviceNumber);
+        bool containsStream(int deviceNumber);
+        Policy getPolicy(int deviceNumber);
+        bool tryAcquire(int deviceNumber, qint64 nBytes);
+        bool acquire(int deviceNumber, qint64 nBytes, int timeout);
+        void release(int deviceNumber, qint64 nBytes);
+        qint64 getLimit(int deviceNumber);
+        qint64 getUsage(int deviceNumber);
+        qint64 getTotalUsage();
+
+    private:
+        typedef struct
+        {
+            int share;
+            Policy policy;
+            qint64 usage;
+        } Stream;
+        bool isAvailable(const Stream &stream, qint64 nBytes) const;
+        qint64 limit(const Stream &stream) const;
+        QHash<int, Stream> m_streamMap;
+        QMutex m_mutex;
+        QWaitCondition m_releasedCondition;
+        qint64 m_budget;
+        int m_totalShares;
+};
+
+#endif // FRAMEMEMORYBUDGET_H
@@ -0,0 +1,73 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* FrameSource.cpp                                                      */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "FrameSource.h"
+
+CameraFrameSource::CameraFrameSource(int deviceNumber)
+{
+    m_deviceNumber = deviceNumber;
+}
+
+bool CameraFrameSource::open()
+{
+    return m_cap.open(m_deviceNumber);
+}
+
+bool CameraFrameSource::isOpened()
+{
+    return m_cap.isOpened();
+}
+
+void CameraFrameSource::release()
+{
+    m_cap.release();
+}
+
+bool CameraFrameSource::grab()
+{
+    return m_cap.grab();
+}
+
+bool CameraFrameSource::retrieve(cv::Mat &frame)
+{
+    return m_cap.retrieve(frame);
+}
+
+bool CameraFrameSource::set(int propId, double value)
+{
+    return m_cap.set(propId, value);
+}
+
+double CameraFrameSource::get(int propId)
+{
+    return m_cap.get(propId);
+}
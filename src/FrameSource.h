@@ -0,0 +1,72 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* FrameSource.h                                                        */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef FRAMESOURCE_H
+#define FRAMESOURCE_H
+
+#include <opencv2/opencv.hpp>
+
+// Source of frames for CaptureThread (subset of the cv::VideoCapture interface, properties are CV_CAP_PROP_*)
+class FrameSource
+{
+    public:
+        virtual ~FrameSource() {}
+        virtual bool open() = 0;
+        virtual bool isOpened() = 0;
+        virtual void release() = 0;
+        // Waits for the next frame
+        virtual bool grab() = 0;
+        // Decodes the grabbed frame
+        virtual bool retrieve(cv::Mat &frame) = 0;
+        virtual bool set(int propId, double value) = 0;
+        virtual double get(int propId) = 0;
+};
+
+// Camera (device number) opened with cv::VideoCapture
+class CameraFrameSource : public FrameSource
+{
+    public:
+        CameraFrameSource(int deviceNumber);
+        bool open();
+        bool isOpened();
+        void release();
+        bool grab();
+        bool retrieve(cv::Mat &frame);
+        bool set(int propId, double value);
+        double get(int propId);
+
+    private:
+        cv::VideoCapture m_cap;
+        int m_deviceNumber;
+};
+
+#endif // FRAMESOURCE_H
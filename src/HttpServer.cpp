@@ -0,0 +1,492 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* HttpServer.cpp                                                       */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "HttpServer.h"
+
+#include "StreamMetrics.h"
+#include "Config.h"
+
+#include <QTcpSocket>
+#include <QThread>
+#include <QCoreApplication>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QDebug>
+
+#include <algorithm>
+
+HttpServer::HttpServer(const QHostAddress &address, quint16 port, ImageEncoderPool *imageEncoderPool, MetricsRegistry *metricsRegistry) :
+    QTcpServer(),
+    m_imageEncoderPool(imageEncoderPool),
+    m_metricsRegistry(metricsRegistry)
+{
+    m_address = address;
+    m_port = port;
+    m_thread = 0;
+    m_isRunning = 0;
+    m_deliveryPending = 0;
+    m_isStreamsEnabled = 0;
+    m_isMetricsEnabled = 0;
+}
+
+HttpServer::~HttpServer()
+{
+    stop();
+}
+
+bool HttpServer::start()
+{
+    if (isRunning())
+    {
+        return true;
+    }
+    // Sockets are serviced in a dedicated thread so that slow clients never stall the GUI thread
+    m_thread = new QThread();
+    moveToThread(m_thread);
+    m_thread->start();
+    // Start listening (in server thread)
+    bool listening = false;
+    QMetaObject::invokeMethod(this, "listenInThread", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, listening));
+    if (!listening)
+    {
+        stop();
+        return false;
+    }
+    m_isRunning = 1;
+    return true;
+}
+
+void HttpServer::stop()
+{
+    if (m_thread == 0)
+    {
+        return;
+    }
+    m_isRunning = 0;
+    // Close server and all client connections (in server thread), then move back to main thread
+    QMetaObject::invokeMethod(this, "closeInThread", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = 0;
+    // Drop any frames still held
+    QMutexLocker locker(&m_streamsMutex);
+    m_streams.clear();
+    m_encodedFrameCache.clear();
+}
+
+bool HttpServer::isRunning()
+{
+    return m_isRunning.load() != 0;
+}
+
+void HttpServer::setStreamsEnabled(bool enable)
+{
+    m_isStreamsEnabled = enable ? 1 : 0;
+    if (!enable)
+    {
+        // Drop frames and disconnect all stream clients (the server may keep running for other endpoints)
+        m_streamsMutex.lock();
+        m_streams.clear();
+        m_encodedFrameCache.clear();
+        m_streamsMutex.unlock();
+        if (isRunning())
+        {
+            QMetaObject::invokeMethod(this, "closeStreams", Qt::QueuedConnection);
+        }
+    }
+}
+
+bool HttpServer::isStreamsEnabled()
+{
+    return m_isStreamsEnabled.load() != 0;
+}
+
+void HttpServer::setMetricsEnabled(bool enable)
+{
+    m_isMetricsEnabled = enable ? 1 : 0;
+}
+
+bool HttpServer::isMetricsEnabled()
+{
+    return m_isMetricsEnabled.load() != 0;
+}
+
+bool HttpServer::listenInThread()
+{
+    if (!listen(m_address, m_port))
+    {
+        qDebug() << "WARNING: HTTP server could not listen on" << m_address.toString() << ":" << m_port << "-" << errorString();
+        return false;
+    }
+    qDebug() << "HTTP server listening on" << m_address.toString() << ":" << m_port;
+    return true;
+}
+
+void HttpServer::closeInThread()
+{
+    close();
+    // Close all client connections (including those already being closed)
+    m_clients.clear();
+    QList<QTcpSocket*> sockets = findChildren<QTcpSocket*>();
+    for (int i = 0; i < sockets.size(); i++)
+    {
+        sockets.at(i)->disconnect(this);
+        sockets.at(i)->abort();
+    }
+    qDeleteAll(sockets);
+    // Return to main thread so the server can be restarted (or deleted) from there
+    moveToThread(QCoreApplication::instance()->thread());
+}
+
+void HttpServer::updateFrame(int deviceNumber, const cv::Mat &frame)
+{
+    // Called from processing threads: just keep a reference to the latest frame (no copy, no encoding)
+    if (!isRunning() || !isStreamsEnabled())
+    {
+        return;
+    }
+    m_streamsMutex.lock();
+    MjpegStream &stream = m_streams[deviceNumber];
+    stream.frame = frame;
+    stream.frameNumber++;
+    m_streamsMutex.unlock();
+    // Wake server thread
+    wakeDelivery();
+}
+
+void HttpServer::wakeDelivery()
+{
+    // At most one pending wake-up
+    if (isRunning() && m_deliveryPending.testAndSetOrdered(0, 1))
+    {
+        QMetaObject::invokeMethod(this, "deliverFrames", Qt::QueuedConnection);
+    }
+}
+
+void HttpServer::removeStream(int deviceNumber)
+{
+    m_streamsMutex.lock();
+    m_streams.remove(deviceNumber);
+    m_encodedFrameCache.remove(deviceNumber);
+    m_streamsMutex.unlock();
+    if (isRunning())
+    {
+        QMetaObject::invokeMethod(this, "closeStream", Qt::QueuedConnection, Q_ARG(int, deviceNumber));
+    }
+}
+
+void HttpServer::closeStream(int deviceNumber)
+{
+    // Disconnect all clients of stream
+    QList<QTcpSocket*> sockets = m_clients.keys();
+    for (int i = 0; i < sockets.size(); i++)
+    {
+        if (m_clients[sockets.at(i)].isStreaming && (m_clients[sockets.at(i)].deviceNumber == deviceNumber))
+        {
+            sockets.at(i)->disconnectFromHost();
+        }
+    }
+}
+
+void HttpServer::closeStreams()
+{
+    // Disconnect all stream clients
+    QList<QTcpSocket*> sockets = m_clients.keys();
+    for (int i = 0; i < sockets.size(); i++)
+    {
+        if (m_clients[sockets.at(i)].isStreaming)
+        {
+            sockets.at(i)->disconnectFromHost();
+        }
+    }
+}
+
+void HttpServer::incomingConnection(qintptr socketDescriptor)
+{
+    QTcpSocket *socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor))
+    {
+        delete socket;
+        return;
+    }
+    // Add client
+    HttpClient client;
+    client.deviceNumber = -1;
+    client.quality = DEFAULT_MJPEG_QUALITY;
+    client.lastFrameNumber = 0;
+    client.isStreaming = false;
+    m_clients[socket] = client;
+    // Connect signals/slots
+    connect(socket, &QTcpSocket::readyRead, this, &HttpServer::readClient);
+    connect(socket, &QTcpSocket::bytesWritten, this, &HttpServer::clientBytesWritten);
+    connect(socket, &QTcpSocket::disconnected, this, &HttpServer::clientDisconnected);
+}
+
+void HttpServer::readClient()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if ((socket == 0) || !m_clients.contains(socket))
+    {
+        return;
+    }
+    HttpClient &client = m_clients[socket];
+    // Ignore anything sent after request has been handled
+    if (client.isStreaming)
+    {
+        socket->readAll();
+        return;
+    }
+    client.request.append(socket->readAll());
+    // Wait for end of request header
+    if (client.request.contains("\r\n\r\n"))
+    {
+        handleRequest(socket);
+    }
+    // Reject oversized requests
+    else if (client.request.size() > HTTP_SERVER_MAX_REQUEST_SIZE)
+    {
+        sendResponse(socket, "413 Request Entity Too Large", "text/plain", "Request too large.\n");
+    }
+}
+
+void HttpServer::handleRequest(QTcpSocket *socket)
+{
+    HttpClient &client = m_clients[socket];
+    // Parse request line: <method> <target> <version>
+    QList<QByteArray> requestLine = client.request.left(client.request.indexOf("\r\n")).split(' ');
+    if ((requestLine.size() < 2) || (requestLine.at(0) != "GET"))
+    {
+        sendResponse(socket, "405 Method Not Allowed", "text/plain", "Only GET is supported.\n");
+        return;
+    }
+    QUrl url(QString::fromLatin1(requestLine.at(1)));
+    QString path = url.path();
+
+    // Stream list (empty while streams are not served)
+    if ((path == "/") || (path.isEmpty()))
+    {
+        QByteArray body;
+        m_streamsMutex.lock();
+        QList<int> deviceNumbers = isStreamsEnabled() ? m_streams.keys() : QList<int>();
+        m_streamsMutex.unlock();
+        std::sort(deviceNumbers.begin(), deviceNumbers.end());
+        for (int i = 0; i < deviceNumbers.size(); i++)
+        {
+            body += "/stream/" + QByteArray::number(deviceNumbers.at(i)) + "\n";
+        }
+        if (isMetricsEnabled())
+        {
+            body += "/metrics\n";
+        }
+        // Encoder statistics
+        ImageEncoderStatisticsData encoderStats = m_imageEncoderPool->getStatistics();
+        body += "\nEncoder queue depth: " + QByteArray::number(encoderStats.queueDepth) + " (max " + QByteArray::number(encoderStats.maxQueueDepth) + ")\n";
+        body += "Encoded: " + QByteArray::number(encoderStats.nImagesEncoded) + ", rejected: " + QByteArray::number(encoderStats.nJobsRejected) +
+                ", failed: " + QByteArray::number(encoderStats.nEncodeFailures) + "\n";
+        body += "Encode time: " + QByteArray::number(encoderStats.averageEncodeTime, 'f', 2) + " ms average, " +
+                QByteArray::number(encoderStats.maxEncodeTime, 'f', 2) + " ms max\n";
+        sendResponse(socket, "200 OK", "text/plain", body);
+    }
+    // MJPEG stream: /stream/<device number>[?quality=<1-100>]
+    else if (path.startsWith("/stream/") && isStreamsEnabled())
+    {
+        bool ok;
+        int deviceNumber = path.mid(QString("/stream/").length()).toInt(&ok);
+        m_streamsMutex.lock();
+        bool streamExists = m_streams.contains(deviceNumber);
+        m_streamsMutex.unlock();
+        if (!ok || !streamExists)
+        {
+            sendResponse(socket, "404 Not Found", "text/plain", "Stream not found.\n");
+            return;
+        }
+        // Quality is clamped to a few levels so that clients requesting similar qualities share encoded frames
+        QUrlQuery query(url);
+        int quality = DEFAULT_MJPEG_QUALITY;
+        if (query.hasQueryItem("quality"))
+        {
+            quality = qBound(1, query.queryItemValue("quality").toInt(), 100);
+            quality = qMax(MJPEG_QUALITY_STEP, (quality / MJPEG_QUALITY_STEP) * MJPEG_QUALITY_STEP);
+        }
+        client.deviceNumber = deviceNumber;
+        client.quality = quality;
+        client.isStreaming = true;
+        client.request.clear();
+        // Send response header
+        socket->write("HTTP/1.0 200 OK\r\n"
+                      "Content-Type: multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY "\r\n"
+                      "Cache-Control: no-cache, no-store\r\n"
+                      "Pragma: no-cache\r\n"
+                      "Connection: close\r\n"
+                      "\r\n");
+        qDebug() << "[" << deviceNumber << "] MJPEG client connected:" << socket->peerAddress().toString() << "( quality" << quality << ")";
+    }
+    // Metrics of all streams (Prometheus text format)
+    else if ((path == "/metrics") && isMetricsEnabled() && (m_metricsRegistry != 0))
+    {
+        sendResponse(socket, "200 OK", "text/plain; version=0.0.4; charset=utf-8", m_metricsRegistry->getText());
+    }
+    else
+    {
+        sendResponse(socket, "404 Not Found", "text/plain", "Not found.\n");
+    }
+}
+
+void HttpServer::sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body)
+{
+    socket->write("HTTP/1.0 " + status + "\r\n"
+                  "Content-Type: " + contentType + "\r\n"
+                  "Content-Length: " + QByteArray::number(body.size()) + "\r\n"
+                  "Connection: close\r\n"
+                  "\r\n" + body);
+    m_clients.remove(socket);
+    socket->disconnectFromHost();
+}
+
+void HttpServer::deliverFrames()
+{
+    // Allow next wake-up
+    m_deliveryPending = 0;
+    // Offer latest frame to all streaming clients
+    QList<QTcpSocket*> sockets = m_clients.keys();
+    for (int i = 0; i < sockets.size(); i++)
+    {
+        deliverFrame(sockets.at(i));
+    }
+}
+
+void HttpServer::clientBytesWritten()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    // Client has drained its socket: send the latest frame (if newer than the last one sent)
+    if ((socket != 0) && (socket->bytesToWrite() == 0))
+    {
+        deliverFrame(socket);
+    }
+}
+
+void HttpServer::deliverFrame(QTcpSocket *socket)
+{
+    if (!m_clients.contains(socket))
+    {
+        return;
+    }
+    HttpClient &client = m_clients[socket];
+    if (!client.isStreaming)
+    {
+        return;
+    }
+    // Slow client: skip frames rather than queueing them (it will get the latest frame once its socket drains)
+    if (socket->bytesToWrite() > 0)
+    {
+        return;
+    }
+    // Get latest encoded frame, requesting encoding of the latest frame if required
+    EncodedImage jpeg;
+    quint64 encodedFrameNumber = 0;
+    m_streamsMutex.lock();
+    if (m_streams.contains(client.deviceNumber))
+    {
+        quint64 frameNumber = m_streams.value(client.deviceNumber).frameNumber;
+        EncodedFrame &cachedFrame = m_encodedFrameCache[client.deviceNumber][client.quality];
+        // Frames are encoded at most once per quality level (shared by all clients) with at most one job in flight
+        if ((cachedFrame.frameNumber < frameNumber) && !cachedFrame.isEncoding)
+        {
+            requestEncoding(client.deviceNumber, client.quality);
+        }
+        jpeg = cachedFrame.image;
+        encodedFrameNumber = cachedFrame.frameNumber;
+    }
+    m_streamsMutex.unlock();
+    // Nothing new to send (the client will be served when encoding has completed)
+    if (jpeg.isEmpty() || (encodedFrameNumber <= client.lastFrameNumber))
+    {
+        return;
+    }
+    client.lastFrameNumber = encodedFrameNumber;
+    // Send part
+    socket->write("--" MJPEG_BOUNDARY "\r\n"
+                  "Content-Type: image/jpeg\r\n"
+                  "Content-Length: " + QByteArray::number(jpeg.size()) + "\r\n"
+                  "\r\n");
+    socket->write(jpeg.data(), jpeg.size());
+    socket->write("\r\n");
+}
+
+void HttpServer::requestEncoding(int deviceNumber, int quality)
+{
+    // Note: m_streamsMutex must be held by caller
+    MjpegStream stream = m_streams.value(deviceNumber);
+    if (stream.frame.empty())
+    {
+        return;
+    }
+    quint64 frameNumber = stream.frameNumber;
+    // Encode in pool (frame is passed by reference)
+    bool queued = m_imageEncoderPool->encodeJpeg(stream.frame, quality,
+        [this, deviceNumber, quality, frameNumber](bool success, const EncodedImage &image)
+        {
+            // Store encoded frame (encoder thread)
+            m_streamsMutex.lock();
+            if (m_streams.contains(deviceNumber))
+            {
+                EncodedFrame &cachedFrame = m_encodedFrameCache[deviceNumber][quality];
+                cachedFrame.isEncoding = false;
+                if (success && (frameNumber > cachedFrame.frameNumber))
+                {
+                    cachedFrame.image = image;
+                    cachedFrame.frameNumber = frameNumber;
+                }
+            }
+            m_streamsMutex.unlock();
+            // Send to waiting clients
+            wakeDelivery();
+        });
+    // Queue full: retried on next delivery
+    m_encodedFrameCache[deviceNumber][quality].isEncoding = queued;
+}
+
+void HttpServer::clientDisconnected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket*>(sender());
+    if (socket == 0)
+    {
+        return;
+    }
+    if (m_clients.contains(socket) && m_clients[socket].isStreaming)
+    {
+        qDebug() << "[" << m_clients[socket].deviceNumber << "] MJPEG client disconnected.";
+    }
+    m_clients.remove(socket);
+    socket->deleteLater();
+}
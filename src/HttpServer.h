@@ -0,0 +1,124 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* HttpServer.h                                                         */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef HTTPSERVER_H
+#define HTTPSERVER_H
+
+#include <QTcpServer>
+#include <QHostAddress>
+#include <QHash>
+#include <QMutex>
+
+#include <opencv2/opencv.hpp>
+
+#include "ImageEncoderPool.h"
+
+class QTcpSocket;
+class QThread;
+class MetricsRegistry;
+
+typedef struct
+{
+    quint64 frameNumber;
+    EncodedImage image;
+    bool isEncoding;
+} EncodedFrame;
+
+typedef struct
+{
+    cv::Mat frame;
+    quint64 frameNumber;
+} MjpegStream;
+
+typedef struct
+{
+    QByteArray request;
+    int deviceNumber;
+    int quality;
+    quint64 lastFrameNumber;
+    bool isStreaming;
+} HttpClient;
+
+class HttpServer : public QTcpServer
+{
+    Q_OBJECT
+
+    public:
+        HttpServer(const QHostAddress &address, quint16 port, ImageEncoderPool *imageEncoderPool, MetricsRegistry *metricsRegistry);
+        ~HttpServer();
+        bool start();
+        void stop();
+        bool isRunning();
+        void updateFrame(int deviceNumber, const cv::Mat &frame);
+        void removeStream(int deviceNumber);
+        void setStreamsEnabled(bool enable);
+        bool isStreamsEnabled();
+        void setMetricsEnabled(bool enable);
+        bool isMetricsEnabled();
+
+    protected:
+        void incomingConnection(qintptr socketDescriptor);
+
+    private:
+        void handleRequest(QTcpSocket *socket);
+        void sendResponse(QTcpSocket *socket, const QByteArray &status, const QByteArray &contentType, const QByteArray &body);
+        void deliverFrame(QTcpSocket *socket);
+        void requestEncoding(int deviceNumber, int quality);
+        void wakeDelivery();
+        ImageEncoderPool *m_imageEncoderPool;
+        MetricsRegistry *m_metricsRegistry;
+        QHostAddress m_address;
+        quint16 m_port;
+        QThread *m_thread;
+        QMutex m_streamsMutex;
+        // Shared with processing and encoder threads (protected by m_streamsMutex)
+        QHash<int, MjpegStream> m_streams;
+        QHash<int, QHash<int, EncodedFrame> > m_encodedFrameCache;
+        // Only accessed from the server thread
+        QHash<QTcpSocket*, HttpClient> m_clients;
+        QAtomicInt m_isRunning;
+        QAtomicInt m_deliveryPending;
+        QAtomicInt m_isStreamsEnabled;
+        QAtomicInt m_isMetricsEnabled;
+
+    private slots:
+        bool listenInThread();
+        void closeInThread();
+        void deliverFrames();
+        void closeStream(int deviceNumber);
+        void closeStreams();
+        void readClient();
+        void clientBytesWritten();
+        void clientDisconnected();
+};
+
+#endif // HTTPSERVER_H
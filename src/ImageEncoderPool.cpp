@@ -0,0 +1,248 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ImageEncoderPool.cpp                                                 */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "ImageEncoderPool.h"
+
+#include "Config.h"
+
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+class EncodeBufferRecycler
+{
+    public:
+        ~EncodeBufferRecycler()
+        {
+            qDeleteAll(m_freeBuffers);
+        }
+        std::vector<uchar>* take()
+        {
+            QMutexLocker locker(&m_mutex);
+            return m_freeBuffers.isEmpty() ? new std::vector<uchar>() : m_freeBuffers.takeLast();
+        }
+        void recycle(std::vector<uchar> *buffer)
+        {
+            QMutexLocker locker(&m_mutex);
+            // Keep capacity (clear() does not free memory) so the next encode does not reallocate
+            if (m_freeBuffers.size() < IMAGE_ENCODER_MAX_FREE_BUFFERS)
+            {
+                buffer->clear();
+                m_freeBuffers.append(buffer);
+            }
+            else
+            {
+                delete buffer;
+            }
+        }
+
+    private:
+        QMutex m_mutex;
+        QList<std::vector<uchar>*> m_freeBuffers;
+};
+
+// Deleter for QSharedPointer: returns buffer to recycler (which may outlive the pool)
+struct EncodeBufferDeleter
+{
+    QSharedPointer<EncodeBufferRecycler> recycler;
+    void operator()(std::vector<uchar> *buffer)
+    {
+        recycler->recycle(buffer);
+    }
+};
+
+class ImageEncoderThread : public QThread
+{
+    public:
+        ImageEncoderThread(ImageEncoderPool *pool) : QThread(), m_pool(pool) {}
+
+    protected:
+        void run()
+        {
+            m_pool->run();
+        }
+
+    private:
+        ImageEncoderPool *m_pool;
+};
+
+ImageEncoderPool::ImageEncoderPool(int nThreads, int maxQueueDepth) :
+    m_bufferRecycler(new EncodeBufferRecycler())
+{
+    m_maxQueueDepth = maxQueueDepth;
+    m_doStop = false;
+    m_encodeTimeSum = 0;
+    m_statsData.queueDepth = 0;
+    m_statsData.maxQueueDepth = 0;
+    m_statsData.nImagesEncoded = 0;
+    m_statsData.nJobsRejected = 0;
+    m_statsData.nEncodeFailures = 0;
+    m_statsData.averageEncodeTime = 0;
+    m_statsData.maxEncodeTime = 0;
+    // Default: half of the available cores (capture/processing threads need the rest)
+    if (nThreads <= 0)
+    {
+        nThreads = qMax(1, QThread::idealThreadCount() / 2);
+    }
+    // Start encoder threads
+    for (int i = 0; i < nThreads; i++)
+    {
+        QThread *thread = new ImageEncoderThread(this);
+        thread->start(QThread::LowPriority);
+        m_threads.append(thread);
+    }
+}
+
+ImageEncoderPool::~ImageEncoderPool()
+{
+    // Stop encoder threads (queued jobs are discarded)
+    m_mutex.lock();
+    m_doStop = true;
+    m_jobs.clear();
+    m_jobAvailable.wakeAll();
+    m_mutex.unlock();
+    for (int i = 0; i < m_threads.size(); i++)
+    {
+        m_threads.at(i)->wait();
+    }
+    qDeleteAll(m_threads);
+}
+
+bool ImageEncoderPool::encode(const cv::Mat &image, const std::string &ext, const std::vector<int> &params, const Callback &callback)
+{
+    // Only a reference to the image is queued: the caller must not modify its pixel data afterwards
+    Job job;
+    job.image = image;
+    job.ext = ext;
+    job.params = params;
+    job.callback = callback;
+
+    QMutexLocker locker(&m_mutex);
+    // Never block the caller: reject job if queue is full
+    if (m_jobs.size() >= m_maxQueueDepth)
+    {
+        m_statsData.nJobsRejected++;
+        return false;
+    }
+    m_jobs.enqueue(job);
+    m_statsData.queueDepth = m_jobs.size();
+    m_statsData.maxQueueDepth = qMax(m_statsData.maxQueueDepth, m_statsData.queueDepth);
+    m_jobAvailable.wakeOne();
+    return true;
+}
+
+bool ImageEncoderPool::encodeJpeg(const cv::Mat &image, int quality, const Callback &callback)
+{
+    std::vector<int> params;
+    params.push_back(cv::IMWRITE_JPEG_QUALITY);
+    params.push_back(quality);
+    return encode(image, ".jpg", params, callback);
+}
+
+ImageEncoderStatisticsData ImageEncoderPool::getStatistics()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_statsData;
+}
+
+QSharedPointer<std::vector<uchar> > ImageEncoderPool::acquireBuffer()
+{
+    EncodeBufferDeleter deleter;
+    deleter.recycler = m_bufferRecycler;
+    return QSharedPointer<std::vector<uchar> >(m_bufferRecycler->take(), deleter);
+}
+
+void ImageEncoderPool::run()
+{
+    QElapsedTimer t;
+    while(1)
+    {
+        // Wait for job
+        m_mutex.lock();
+        while (m_jobs.isEmpty() && !m_doStop)
+        {
+            m_jobAvailable.wait(&m_mutex);
+        }
+        if (m_doStop)
+        {
+            m_mutex.unlock();
+            break;
+        }
+        Job job = m_jobs.dequeue();
+        m_statsData.queueDepth = m_jobs.size();
+        m_mutex.unlock();
+
+        // Encode into a recycled buffer
+        t.start();
+        QSharedPointer<std::vector<uchar> > buffer = acquireBuffer();
+        cv::Mat image = job.image;
+        bool success = false;
+        // JPEG supports 1 and 3 channels only
+        if ((image.channels() == 4) && ((job.ext == ".jpg") || (job.ext == ".jpeg")))
+        {
+            cv::cvtColor(image, image, cv::COLOR_BGRA2BGR);
+        }
+        try
+        {
+            success = cv::imencode(job.ext, image, *buffer, job.params);
+        }
+        catch (cv::Exception &e)
+        {
+            qDebug() << "WARNING: Image encoding failed:" << e.what();
+        }
+        // Release reference to source image as soon as possible
+        job.image.release();
+        image.release();
+        double encodeTime = t.nsecsElapsed() / 1000000.0;
+
+        // Update statistics
+        m_mutex.lock();
+        if (success)
+        {
+            m_statsData.nImagesEncoded++;
+            m_encodeTimeSum += encodeTime;
+            m_statsData.averageEncodeTime = m_encodeTimeSum / m_statsData.nImagesEncoded;
+            m_statsData.maxEncodeTime = qMax(m_statsData.maxEncodeTime, encodeTime);
+        }
+        else
+        {
+            m_statsData.nEncodeFailures++;
+        }
+        m_mutex.unlock();
+
+        // Inform caller
+        if (job.callback)
+        {
+            job.callback(success, success ? EncodedImage(buffer) : EncodedImage());
+        }
+    }
+}
@@ -0,0 +1,110 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ImageEncoderPool.h                                                   */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef IMAGEENCODERPOOL_H
+#define IMAGEENCODERPOOL_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QList>
+#include <QSharedPointer>
+
+#include <opencv2/opencv.hpp>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Structures.h"
+
+class QThread;
+class EncodeBufferRecycler;
+
+// Compressed image produced by ImageEncoderPool. The underlying buffer is returned to the pool for reuse once the
+// last copy of the EncodedImage is destroyed.
+class EncodedImage
+{
+    public:
+        EncodedImage() {}
+        EncodedImage(const QSharedPointer<std::vector<uchar> > &buffer) : m_buffer(buffer) {}
+        const char* data() const
+        {
+            return m_buffer.isNull() ? 0 : (const char*)m_buffer->data();
+        }
+        int size() const
+        {
+            return m_buffer.isNull() ? 0 : (int)m_buffer->size();
+        }
+        bool isEmpty() const
+        {
+            return size() == 0;
+        }
+
+    private:
+        QSharedPointer<std::vector<uchar> > m_buffer;
+};
+
+class ImageEncoderPool
+{
+    public:
+        // Called from an encoder thread when the job has completed (or failed)
+        typedef std::function<void(bool success, const EncodedImage &image)> Callback;
+        ImageEncoderPool(int nThreads, int maxQueueDepth);
+        ~ImageEncoderPool();
+        bool encode(const cv::Mat &image, const std::string &ext, const std::vector<int> &params, const Callback &callback);
+        bool encodeJpeg(const cv::Mat &image, int quality, const Callback &callback);
+        ImageEncoderStatisticsData getStatistics();
+
+    private:
+        friend class ImageEncoderThread;
+        typedef struct
+        {
+            cv::Mat image;
+            std::string ext;
+            std::vector<int> params;
+            Callback callback;
+        } Job;
+        void run();
+        QSharedPointer<std::vector<uchar> > acquireBuffer();
+        QMutex m_mutex;
+        QWaitCondition m_jobAvailable;
+        QQueue<Job> m_jobs;
+        QList<QThread*> m_threads;
+        QSharedPointer<EncodeBufferRecycler> m_bufferRecycler;
+        ImageEncoderStatisticsData m_statsData;
+        double m_encodeTimeSum;
+        int m_maxQueueDepth;
+        bool m_doStop;
+};
+
+#endif // IMAGEENCODERPOOL_H
@@ -0,0 +1,546 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ImageFilters.cpp                                                     */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "ImageFilters.h"
+
+#include "SimdKernels.h"
+#include "Config.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace {
+    struct MaxOp
+    {
+        // Value of pixels outside the image (never selected)
+        static uchar neutral() { return 0; }
+        static uchar apply(uchar a, uchar b) { return a > b ? a : b; }
+    };
+
+    struct MinOp
+    {
+        static uchar neutral() { return 255; }
+        static uchar apply(uchar a, uchar b) { return a < b ? a : b; }
+    };
+
+    // Working buffers of van Herk/Gil-Werman filters: one set per thread, shared by dilation and erosion (grown to the
+    // largest frame once, no allocation afterwards)
+    struct VanHerkBuffers
+    {
+        std::vector<uchar> rowResult;
+        std::vector<uchar> rowG;
+        std::vector<uchar> rowH;
+        std::vector<uchar> columnG;
+        std::vector<uchar> columnH;
+    };
+
+    VanHerkBuffers& getVanHerkBuffers()
+    {
+        static thread_local VanHerkBuffers buffers;
+        return buffers;
+    }
+
+    // Van Herk/Gil-Werman running min/max over a window of 2*radius+1 elements. The padded line is split into
+    // blocks of window size: g holds the prefix result within each block, h the suffix result. The window
+    // starting at x spans at most two blocks, so result[x] = op(h[x], g[x+2*radius]).
+    // Rows: elements are pixels with interleaved channels (stride = number of channels).
+    template<typename Op>
+    void vanHerkRow(const uchar *src, uchar *dst, int width, int channels, int radius, std::vector<uchar> &g, std::vector<uchar> &h)
+    {
+        int windowSize = 2 * radius + 1;
+        int paddedWidth = ((width + 2 * radius + windowSize - 1) / windowSize) * windowSize;
+        int paddedLength = paddedWidth * channels;
+        g.resize(paddedLength);
+        h.resize(paddedLength);
+        // Padded line: neutral value outside image
+        for (int i = 0; i < radius * channels; i++)
+        {
+            g[i] = Op::neutral();
+        }
+        for (int i = 0; i < width * channels; i++)
+        {
+            g[radius * channels + i] = src[i];
+        }
+        for (int i = (width + radius) * channels; i < paddedLength; i++)
+        {
+            g[i] = Op::neutral();
+        }
+        h.resize(paddedLength);
+        std::copy(g.begin(), g.end(), h.begin());
+        // Prefix (g) and suffix (h) results within each block
+        for (int block = 0; block < paddedLength; block += windowSize * channels)
+        {
+            int blockEnd = block + windowSize * channels;
+            for (int i = block + channels; i < blockEnd; i++)
+            {
+                g[i] = Op::apply(g[i], g[i - channels]);
+            }
+            for (int i = blockEnd - channels - 1; i >= block; i--)
+            {
+                h[i] = Op::apply(h[i], h[i + channels]);
+            }
+        }
+        // Combine
+        int offset = 2 * radius * channels;
+        for (int i = 0; i < width * channels; i++)
+        {
+            dst[i] = Op::apply(h[i], g[i + offset]);
+        }
+    }
+
+    // Columns: same algorithm with whole rows as elements (rows are combined element-wise, which vectorizes well)
+    template<typename Op>
+    void vanHerkColumns(const cv::Mat &src, cv::Mat &dst, int radius, std::vector<uchar> &g, std::vector<uchar> &h)
+    {
+        int windowSize = 2 * radius + 1;
+        int rowLength = src.cols * src.channels();
+        int paddedHeight = ((src.rows + 2 * radius + windowSize - 1) / windowSize) * windowSize;
+        g.resize((size_t)paddedHeight * rowLength);
+        for (int y = 0; y < paddedHeight; y++)
+        {
+            int srcY = y - radius;
+            uchar *gRow = &g[(size_t)y * rowLength];
+            if ((srcY >= 0) && (srcY < src.rows))
+            {
+                const uchar *srcRow = src.ptr<uchar>(srcY);
+                std::copy(srcRow, srcRow + rowLength, gRow);
+            }
+            else
+            {
+                std::fill(gRow, gRow + rowLength, Op::neutral());
+            }
+        }
+        h.resize(g.size());
+        std::copy(g.begin(), g.end(), h.begin());
+        for (int block = 0; block < paddedHeight; block += windowSize)
+        {
+            for (int y = block + 1; y < block + windowSize; y++)
+            {
+                uchar *gRow = &g[(size_t)y * rowLength];
+                const uchar *gPrevRow = gRow - rowLength;
+                for (int i = 0; i < rowLength; i++)
+                {
+                    gRow[i] = Op::apply(gRow[i], gPrevRow[i]);
+                }
+            }
+            for (int y = block + windowSize - 2; y >= block; y--)
+            {
+                uchar *hRow = &h[(size_t)y * rowLength];
+                const uchar *hNextRow = hRow + rowLength;
+                for (int i = 0; i < rowLength; i++)
+                {
+                    hRow[i] = Op::apply(hRow[i], hNextRow[i]);
+                }
+            }
+        }
+        for (int y = 0; y < src.rows; y++)
+        {
+            const uchar *hRow = &h[(size_t)y * rowLength];
+            const uchar *gRow = &g[(size_t)(y + 2 * radius) * rowLength];
+            uchar *dstRow = dst.ptr<uchar>(y);
+            for (int i = 0; i < rowLength; i++)
+            {
+                dstRow[i] = Op::apply(hRow[i], gRow[i]);
+            }
+        }
+    }
+
+    // Separable (2*radius+1)x(2*radius+1) rectangle: rows, then columns
+    template<typename Op>
+    void vanHerkRect(const cv::Mat &src, cv::Mat &dst, int radius)
+    {
+        VanHerkBuffers &buffers = getVanHerkBuffers();
+        // Row pass result wraps the working buffer (frames of other size, e.g. after an ROI change, do not reallocate
+        // unless larger)
+        buffers.rowResult.resize(src.total() * src.elemSize());
+        cv::Mat rowResult(src.size(), src.type(), buffers.rowResult.data());
+        for (int y = 0; y < src.rows; y++)
+        {
+            vanHerkRow<Op>(src.ptr<uchar>(y), rowResult.ptr<uchar>(y), src.cols, src.channels(), radius, buffers.rowG, buffers.rowH);
+        }
+        dst.create(src.size(), src.type());
+        vanHerkColumns<Op>(rowResult, dst, radius, buffers.columnG, buffers.columnH);
+    }
+
+    // Index of pixel outside [0, length) with BORDER_REFLECT_101 (as cv::borderInterpolate)
+    int reflect101(int i, int length)
+    {
+        if (length == 1)
+        {
+            return 0;
+        }
+        while ((i < 0) || (i >= length))
+        {
+            i = (i < 0) ? -i : 2 * length - 2 - i;
+        }
+        return i;
+    }
+
+    int replicate(int i, int length)
+    {
+        return std::min(std::max(i, 0), length - 1);
+    }
+
+    // Rolling window of rows for grayBlurCanny(): each stage keeps only the rows the next stage needs
+    class GrayBlurCannyPass
+    {
+        public:
+            GrayBlurCannyPass() :
+                m_src(0),
+                m_width(0),
+                m_height(0),
+                m_low(0),
+                m_high(0),
+                m_L2gradient(false),
+                m_nBlurredRows(0),
+                m_mapStep(0)
+            {
+            }
+
+            // Buffers are resized (not reallocated once large enough) when the pass is run again
+            void run(const cv::Mat &src, cv::Mat &dst, cv::Size blurSize, int lowThreshold, int highThreshold, bool L2gradient)
+            {
+                m_src = &src;
+                m_width = src.cols;
+                m_height = src.rows;
+                m_blurSize = blurSize;
+                m_low = lowThreshold;
+                m_high = highThreshold;
+                m_L2gradient = L2gradient;
+                m_grayRow.resize(m_width);
+                m_columnSum.assign(m_width, 0);
+                m_nBlurredRows = 0;
+                m_mapStep = m_width + 2;
+                m_map.assign((size_t)m_mapStep * (m_height + 2), 1);
+                m_stack.clear();
+                for (int i = 0; i < 3; i++)
+                {
+                    m_blurredRows[i].resize(m_width);
+                    m_magRows[i].assign(m_width + 2, 0);
+                    m_dxRows[i].resize(m_width);
+                    m_dyRows[i].resize(m_width);
+                }
+                // Gradient magnitude of row y is computed one row ahead of non-maximum suppression (row y-1)
+                for (int y = 0; y <= m_height; y++)
+                {
+                    if (y < m_height)
+                    {
+                        computeGradientRow(y);
+                    }
+                    else
+                    {
+                        std::fill(m_magRows[y % 3].begin(), m_magRows[y % 3].end(), 0);
+                    }
+                    if (y > 0)
+                    {
+                        suppressNonMaxima(y - 1);
+                    }
+                }
+                trackEdges();
+                // Output
+                dst.create(m_height, m_width, CV_8UC1);
+                for (int y = 0; y < m_height; y++)
+                {
+                    const uchar *mapRow = &m_map[(size_t)(y + 1) * m_mapStep + 1];
+                    uchar *dstRow = dst.ptr<uchar>(y);
+                    for (int x = 0; x < m_width; x++)
+                    {
+                        dstRow[x] = (mapRow[x] == 2) ? 255 : 0;
+                    }
+                }
+            }
+
+        private:
+            // Grayscale row (fixed-point coefficients of cv::cvtColor)
+            const uchar *getGrayRow(int y)
+            {
+                const uchar *srcRow = m_src->ptr<uchar>(y);
+                int channels = m_src->channels();
+                if (channels == 1)
+                {
+                    return srcRow;
+                }
+                for (int x = 0; x < m_width; x++)
+                {
+                    const uchar *pixel = srcRow + x * channels;
+                    m_grayRow[x] = (uchar)((pixel[0] * 1868 + pixel[1] * 9617 + pixel[2] * 4899 + (1 << 13)) >> 14);
+                }
+                return &m_grayRow[0];
+            }
+
+            void addGrayRow(int y, int sign)
+            {
+                const uchar *grayRow = getGrayRow(reflect101(y, m_height));
+                for (int x = 0; x < m_width; x++)
+                {
+                    m_columnSum[x] += sign * grayRow[x];
+                }
+            }
+
+            // Box filter: vertical sums are updated incrementally from row to row, horizontal sums from pixel to pixel
+            void computeBlurredRow(int y)
+            {
+                int anchorY = m_blurSize.height / 2;
+                if (y == 0)
+                {
+                    for (int i = 0; i < m_blurSize.height; i++)
+                    {
+                        addGrayRow(i - anchorY, 1);
+                    }
+                }
+                else
+                {
+                    addGrayRow(y - anchorY + m_blurSize.height - 1, 1);
+                    addGrayRow(y - anchorY - 1, -1);
+                }
+                int anchorX = m_blurSize.width / 2;
+                double scale = 1.0 / (m_blurSize.width * m_blurSize.height);
+                int sum = 0;
+                for (int i = 0; i < m_blurSize.width; i++)
+                {
+                    sum += m_columnSum[reflect101(i - anchorX, m_width)];
+                }
+                uchar *blurredRow = &m_blurredRows[y % 3][0];
+                for (int x = 0; x < m_width; x++)
+                {
+                    blurredRow[x] = cv::saturate_cast<uchar>(sum * scale);
+                    sum += m_columnSum[reflect101(x + 1 - anchorX + m_blurSize.width - 1, m_width)] - m_columnSum[reflect101(x - anchorX, m_width)];
+                }
+                m_nBlurredRows = y + 1;
+            }
+
+            // 3x3 Sobel (border replicated, as cv::Canny) and gradient magnitude
+            void computeGradientRow(int y)
+            {
+                while (m_nBlurredRows <= std::min(y + 1, m_height - 1))
+                {
+                    computeBlurredRow(m_nBlurredRows);
+                }
+                const uchar *prev = &m_blurredRows[replicate(y - 1, m_height) % 3][0];
+                const uchar *cur = &m_blurredRows[y % 3][0];
+                const uchar *next = &m_blurredRows[replicate(y + 1, m_height) % 3][0];
+                short *dxRow = &m_dxRows[y % 3][0];
+                short *dyRow = &m_dyRows[y % 3][0];
+                int *magRow = &m_magRows[y % 3][1];
+                for (int x = 0; x < m_width; x++)
+                {
+                    int left = replicate(x - 1, m_width);
+                    int right = replicate(x + 1, m_width);
+                    int dx = (prev[right] - prev[left]) + 2 * (cur[right] - cur[left]) + (next[right] - next[left]);
+                    int dy = (next[left] + 2 * next[x] + next[right]) - (prev[left] + 2 * prev[x] + prev[right]);
+                    dxRow[x] = (short)dx;
+                    dyRow[x] = (short)dy;
+                    magRow[x] = m_L2gradient ? dx * dx + dy * dy : std::abs(dx) + std::abs(dy);
+                }
+            }
+
+            // Non-maximum suppression and classification (as cv::Canny): 0: weak edge, 1: no edge, 2: strong edge
+            void suppressNonMaxima(int y)
+            {
+                const int shift = 15;
+                const int tg22 = (int)(0.4142135623730950488016887242097 * (1 << shift) + 0.5);
+                const int *magPrev = &m_magRows[(y + 2) % 3][1];
+                const int *magCur = &m_magRows[y % 3][1];
+                const int *magNext = &m_magRows[(y + 1) % 3][1];
+                const short *dxRow = &m_dxRows[y % 3][0];
+                const short *dyRow = &m_dyRows[y % 3][0];
+                uchar *mapRow = &m_map[(size_t)(y + 1) * m_mapStep + 1];
+                for (int x = 0; x < m_width; x++)
+                {
+                    int m = magCur[x];
+                    bool isMaximum = false;
+                    if (m > m_low)
+                    {
+                        int xs = std::abs(dxRow[x]);
+                        int ys = std::abs(dyRow[x]) << shift;
+                        int tg22x = xs * tg22;
+                        // Horizontal gradient
+                        if (ys < tg22x)
+                        {
+                            isMaximum = (m > magCur[x - 1]) && (m >= magCur[x + 1]);
+                        }
+                        else
+                        {
+                            int tg67x = tg22x + (xs << (shift + 1));
+                            // Vertical gradient
+                            if (ys > tg67x)
+                            {
+                                isMaximum = (m > magPrev[x]) && (m >= magNext[x]);
+                            }
+                            // Diagonal gradient
+                            else
+                            {
+                                int s = ((dxRow[x] ^ dyRow[x]) < 0) ? -1 : 1;
+                                isMaximum = (m > magPrev[x - s]) && (m > magNext[x + s]);
+                            }
+                        }
+                    }
+                    if (!isMaximum)
+                    {
+                        mapRow[x] = 1;
+                    }
+                    else if (m > m_high)
+                    {
+                        mapRow[x] = 2;
+                        m_stack.push_back(&mapRow[x]);
+                    }
+                    else
+                    {
+                        mapRow[x] = 0;
+                    }
+                }
+            }
+
+            // Hysteresis: weak edges connected to strong edges become strong edges
+            void trackEdges()
+            {
+                const int offsets[8] = { -m_mapStep - 1, -m_mapStep, -m_mapStep + 1, -1, 1, m_mapStep - 1, m_mapStep, m_mapStep + 1 };
+                while (!m_stack.empty())
+                {
+                    uchar *pixel = m_stack.back();
+                    m_stack.pop_back();
+                    for (int i = 0; i < 8; i++)
+                    {
+                        if (pixel[offsets[i]] == 0)
+                        {
+                            pixel[offsets[i]] = 2;
+                            m_stack.push_back(pixel + offsets[i]);
+                        }
+                    }
+                }
+            }
+
+            const cv::Mat *m_src;
+            int m_width;
+            int m_height;
+            cv::Size m_blurSize;
+            int m_low;
+            int m_high;
+            bool m_L2gradient;
+            std::vector<uchar> m_grayRow;
+            std::vector<int> m_columnSum;
+            std::vector<uchar> m_blurredRows[3];
+            int m_nBlurredRows;
+            std::vector<int> m_magRows[3];
+            std::vector<short> m_dxRows[3];
+            std::vector<short> m_dyRows[3];
+            int m_mapStep;
+            std::vector<uchar> m_map;
+            std::vector<uchar*> m_stack;
+    };
+}
+
+void dilateRect(const cv::Mat &src, cv::Mat &dst, int iterations)
+{
+    // N iterations of a 3x3 rectangle are equivalent to a single (2N+1)x(2N+1) rectangle (pixels outside the image are ignored)
+    if ((iterations >= MORPHOLOGY_VAN_HERK_MIN_ITERATIONS) && (src.depth() == CV_8U))
+    {
+        vanHerkRect<MaxOp>(src, dst, iterations);
+    }
+    else
+    {
+        cv::dilate(src, dst, cv::Mat(), cv::Point(-1, -1), iterations);
+    }
+}
+
+void erodeRect(const cv::Mat &src, cv::Mat &dst, int iterations)
+{
+    if ((iterations >= MORPHOLOGY_VAN_HERK_MIN_ITERATIONS) && (src.depth() == CV_8U))
+    {
+        vanHerkRect<MinOp>(src, dst, iterations);
+    }
+    else
+    {
+        cv::erode(src, dst, cv::Mat(), cv::Point(-1, -1), iterations);
+    }
+}
+
+void grayBlurCanny(const cv::Mat &src, cv::Mat &dst, cv::Size blurSize, double threshold1, double threshold2, bool L2gradient)
+{
+    if ((src.depth() != CV_8U) || (src.channels() == 2) || (src.channels() > 4) || src.empty() || (blurSize.width < 1) || (blurSize.height < 1))
+    {
+        cv::Mat grayFrame;
+        if (src.channels() >= 3)
+        {
+            cv::cvtColor(src, grayFrame, CV_BGR2GRAY);
+            cv::blur(grayFrame, grayFrame, blurSize);
+        }
+        else
+        {
+            cv::blur(src, grayFrame, blurSize);
+        }
+        cv::Canny(grayFrame, dst, threshold1, threshold2, 3, L2gradient);
+        return;
+    }
+    // Thresholds (as cv::Canny)
+    if (threshold1 > threshold2)
+    {
+        std::swap(threshold1, threshold2);
+    }
+    if (L2gradient)
+    {
+        threshold1 = std::min(32767.0, threshold1);
+        threshold2 = std::min(32767.0, threshold2);
+        threshold1 = (threshold1 > 0) ? threshold1 * threshold1 : threshold1;
+        threshold2 = (threshold2 > 0) ? threshold2 * threshold2 : threshold2;
+    }
+    // Output is written after the whole input has been read (in-place operation is allowed)
+    static thread_local GrayBlurCannyPass pass;
+    pass.run(src, dst, blurSize, cvFloor(threshold1), cvFloor(threshold2), L2gradient);
+}
+
+void bgrToGray(const cv::Mat &src, cv::Mat &dst)
+{
+    int level = getSimdKernelSelection().bgrToGray;
+    if ((level < 0) || !simdBgrToGray(src, dst, level))
+    {
+        cv::cvtColor(src, dst, CV_BGR2GRAY);
+    }
+}
+
+void boxBlur(const cv::Mat &src, cv::Mat &dst, cv::Size ksize)
+{
+    int level = getSimdKernelSelection().boxBlur;
+    if ((level < 0) || (src.depth() != CV_8U) || !isSimdBoxBlurExact(ksize, src.channels(), level) || !simdBoxBlur(src, dst, ksize, level))
+    {
+        cv::blur(src, dst, ksize);
+    }
+}
+
+void flipImage(const cv::Mat &src, cv::Mat &dst, int flipCode)
+{
+    int level = getSimdKernelSelection().flip;
+    if ((level < 0) || !simdFlip(src, dst, flipCode, level))
+    {
+        cv::flip(src, dst, flipCode);
+    }
+}
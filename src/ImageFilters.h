@@ -0,0 +1,53 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ImageFilters.h                                                       */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef IMAGEFILTERS_H
+#define IMAGEFILTERS_H
+
+#include <opencv2/opencv.hpp>
+
+// Equivalent to cv::dilate/cv::erode with the default 3x3 kernel and the given number of iterations.
+// For 8-bit images and large iteration counts a single (2N+1)x(2N+1) van Herk/Gil-Werman pass is used
+// (constant cost per pixel, independent of the number of iterations).
+void dilateRect(const cv::Mat &src, cv::Mat &dst, int iterations);
+void erodeRect(const cv::Mat &src, cv::Mat &dst, int iterations);
+// Equivalent to cv::cvtColor (to grayscale), cv::blur and cv::Canny (aperture size 3) in sequence. For 8-bit images a
+// single pass over a rolling window of rows is used: intermediate images (grayscale, blurred, gradients) are never
+// stored in full, only the edge classification map is.
+void grayBlurCanny(const cv::Mat &src, cv::Mat &dst, cv::Size blurSize, double threshold1, double threshold2, bool L2gradient);
+// Equivalent to cv::cvtColor (BGR to grayscale), cv::blur and cv::flip. The hand-vectorized kernels of SimdKernels.h are
+// used where they were selected at startup (box blur: only for kernel sizes matching OpenCV), OpenCV otherwise.
+void bgrToGray(const cv::Mat &src, cv::Mat &dst);
+void boxBlur(const cv::Mat &src, cv::Mat &dst, cv::Size ksize);
+void flipImage(const cv::Mat &src, cv::Mat &dst, int flipCode);
+
+#endif // IMAGEFILTERS_H
@@ -0,0 +1,139 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* LatencyBarcode.cpp                                                   */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "LatencyBarcode.h"
+
+#include "Config.h"
+
+// Layout (bytes, sent MSB first): sync byte, timestamp (6 bytes), sequence number (3 bytes), CRC-16 of timestamp and
+// sequence number (2 bytes)
+#define BARCODE_SYNC                        0xB2
+#define BARCODE_N_BYTES                     12
+#define BARCODE_N_BITS                      (BARCODE_N_BYTES * 8)
+
+// CRC-16/CCITT-FALSE
+static quint16 crc16(const quint8 *data, int length)
+{
+    quint16 crc = 0xFFFF;
+    for (int i = 0; i < length; i++)
+    {
+        crc ^= (quint16)data[i] << 8;
+        for (int j = 0; j < 8; j++)
+        {
+            crc = (crc & 0x8000) ? (quint16)((crc << 1) ^ 0x1021) : (quint16)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+// Top-left corner of cell of given bit: cells fill the top rows from left to right (false if frame is too small)
+static bool getCellPosition(int width, int height, int bit, int *x, int *y)
+{
+    int cellsPerRow = width / LATENCY_BARCODE_CELL_SIZE;
+    if ((cellsPerRow == 0) || (((BARCODE_N_BITS + cellsPerRow - 1) / cellsPerRow) * LATENCY_BARCODE_CELL_SIZE > height))
+    {
+        return false;
+    }
+    *x = (bit % cellsPerRow) * LATENCY_BARCODE_CELL_SIZE;
+    *y = (bit / cellsPerRow) * LATENCY_BARCODE_CELL_SIZE;
+    return true;
+}
+
+bool writeLatencyBarcode(cv::Mat &frame, qint64 timestamp, quint32 sequenceNumber)
+{
+    if ((frame.depth() != CV_8U) || ((frame.channels() != 1) && (frame.channels() != 3)))
+    {
+        return false;
+    }
+    // Pack data
+    quint8 bytes[BARCODE_N_BYTES];
+    bytes[0] = BARCODE_SYNC;
+    for (int i = 0; i < 6; i++)
+    {
+        bytes[1 + i] = (quint8)(timestamp >> (8 * (5 - i)));
+    }
+    for (int i = 0; i < 3; i++)
+    {
+        bytes[7 + i] = (quint8)(sequenceNumber >> (8 * (2 - i)));
+    }
+    quint16 crc = crc16(bytes + 1, 9);
+    bytes[10] = (quint8)(crc >> 8);
+    bytes[11] = (quint8)crc;
+    // Draw cells
+    for (int bit = 0; bit < BARCODE_N_BITS; bit++)
+    {
+        int x, y;
+        if (!getCellPosition(frame.cols, frame.rows, bit, &x, &y))
+        {
+            return false;
+        }
+        bool isSet = (bytes[bit / 8] >> (7 - (bit % 8))) & 1;
+        frame(cv::Rect(x, y, LATENCY_BARCODE_CELL_SIZE, LATENCY_BARCODE_CELL_SIZE)).setTo(cv::Scalar::all(isSet ? 255 : 0));
+    }
+    return true;
+}
+
+bool readLatencyBarcode(const QImage &image, qint64 *timestamp, quint32 *sequenceNumber)
+{
+    // Sample center of each cell
+    quint8 bytes[BARCODE_N_BYTES] = {0};
+    for (int bit = 0; bit < BARCODE_N_BITS; bit++)
+    {
+        int x, y;
+        if (!getCellPosition(image.width(), image.height(), bit, &x, &y))
+        {
+            return false;
+        }
+        if (qGray(image.pixel(x + LATENCY_BARCODE_CELL_SIZE / 2, y + LATENCY_BARCODE_CELL_SIZE / 2)) > 127)
+        {
+            bytes[bit / 8] |= (quint8)(1 << (7 - (bit % 8)));
+        }
+        // Not a barcode (checked early: called for every displayed frame)
+        if ((bit == 7) && (bytes[0] != BARCODE_SYNC))
+        {
+            return false;
+        }
+    }
+    // Check CRC
+    if (crc16(bytes + 1, 9) != (quint16)((bytes[10] << 8) | bytes[11]))
+    {
+        return false;
+    }
+    // Unpack data
+    *timestamp = 0;
+    for (int i = 0; i < 6; i++)
+    {
+        *timestamp = (*timestamp << 8) | bytes[1 + i];
+    }
+    *sequenceNumber = ((quint32)bytes[7] << 16) | ((quint32)bytes[8] << 8) | bytes[9];
+    return true;
+}
@@ -0,0 +1,50 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* LatencyBarcode.h                                                     */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef LATENCYBARCODE_H
+#define LATENCYBARCODE_H
+
+#include <QImage>
+
+#include <opencv2/opencv.hpp>
+
+// Binary barcode in the top rows of a frame carrying the capture timestamp (ms, see currentTimestamp()) and a sequence
+// number (24 bits): written by the source, read back where the frame is displayed (glass-to-glass latency).
+// Cells are black/white squares of LATENCY_BARCODE_CELL_SIZE pixels and survive color conversion and small smoothing
+// kernels. The barcode is not found if the frame is cropped (ROI), scaled, flipped or edge-detected.
+
+// Writes barcode into frame (8-bit, 1 or 3 channels). Returns false if the frame is too small.
+bool writeLatencyBarcode(cv::Mat &frame, qint64 timestamp, quint32 sequenceNumber);
+// Reads barcode from image (as converted for display). Returns false if no valid barcode was found.
+bool readLatencyBarcode(const QImage &image, qint64 *timestamp, quint32 *sequenceNumber);
+
+#endif // LATENCYBARCODE_H
@@ -36,8 +36,12 @@
 #include "SharedImageBuffer.h"
 #include "CameraView.h"
 #include "CameraConnectDialog.h"
+#include "HttpServer.h"
+#include "StreamMetrics.h"
+#include "ImageEncoderPool.h"
 #include "Config.h"
 
+#include <QInputDialog>
 #include <QLabel>
 #include <QMessageBox>
 #include <QPushButton>
@@ -66,12 +70,35 @@ MainWindow::MainWindow(QWidget *parent) :
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::showAboutDialog);
     connect(ui->actionQuit, &QAction::triggered, this, &MainWindow::close);
     connect(ui->actionFullScreen, &QAction::toggled, this, &MainWindow::setFullScreen);
+    connect(ui->actionServeStreamsOverHttp, &QAction::toggled, this, &MainWindow::setHttpServerEnabled);
+    connect(ui->actionServeMetricsOverHttp, &QAction::toggled, this, &MainWindow::setHttpMetricsEnabled);
+    connect(ui->actionSetFrameMemoryBudget, &QAction::triggered, this, &MainWindow::setFrameMemoryBudget);
+    // Shared memory frame bus is only available on POSIX systems
+#ifndef Q_OS_UNIX
+    ui->actionPublishToSharedMemory->setEnabled(false);
+#endif
     // Create SharedImageBuffer object
     m_sharedImageBuffer = new SharedImageBuffer();
+    // Create ImageEncoderPool object (shared by all JPEG/PNG outputs)
+    m_imageEncoderPool = new ImageEncoderPool(IMAGE_ENCODER_THREADS, IMAGE_ENCODER_MAX_QUEUE_DEPTH);
+    // Create MetricsRegistry object (metrics of all streams, exported by HTTP server)
+    m_metricsRegistry = new MetricsRegistry(m_sharedImageBuffer->getFrameMemoryBudget(), m_imageEncoderPool);
+    // Create HttpServer object (not started until streams or metrics are enabled in the Options menu)
+    m_httpServer = new HttpServer(QHostAddress(HTTP_SERVER_ADDRESS), HTTP_SERVER_PORT, m_imageEncoderPool, m_metricsRegistry);
+    ui->actionServeMetricsOverHttp->setChecked(DEFAULT_HTTP_SERVER_METRICS);
 }
 
 MainWindow::~MainWindow()
 {
+    // Disconnect all cameras first (CameraView removes its stream from the HTTP server when deleted)
+    qDeleteAll(m_cameraViewMap);
+    m_cameraViewMap.clear();
+    // Stop HTTP server
+    m_httpServer->stop();
+    // Delete encoder pool before HTTP server (discards queued jobs and waits for jobs in progress, whose callbacks use the server)
+    delete m_imageEncoderPool;
+    delete m_httpServer;
+    delete m_metricsRegistry;
     delete ui;
 }
 
@@ -102,10 +129,20 @@ void MainWindow::connectToCamera()
             {
                 // Create ImageBuffer with user-defined size
                 Buffer<cv::Mat> *imageBuffer = new Buffer<cv::Mat>(cameraConnectDialog->getImageBufferSize());
+                // Compress frames stored beyond the head of the buffer (if enabled)
+                if(cameraConnectDialog->getBufferCompressionCheckBoxState())
+                {
+                    imageBuffer->setCompressionEnabled(cameraConnectDialog->getBufferCompressionRawFrames(), cameraConnectDialog->getBufferCompressionQuality());
+                }
+                // Account frames held by ImageBuffer against frame memory budget
+                m_sharedImageBuffer->getFrameMemoryBudget()->addStream(deviceNumber,
+                                                                       cameraConnectDialog->getFrameMemoryShare(),
+                                                                       (FrameMemoryBudget::Policy)cameraConnectDialog->getFrameMemoryPolicy());
+                imageBuffer->setMemoryBudget(m_sharedImageBuffer->getFrameMemoryBudget(), deviceNumber, FRAME_MEMORY_BLOCK_TIMEOUT);
                 // Add created ImageBuffer to SharedImageBuffer object
-                m_sharedImageBuffer->add(deviceNumber, imageBuffer, ui->actionSynchronizeStreams->isChecked());
+                m_sharedImageBuffer->add(deviceNumber, imageBuffer, ui->actionSynchronizeStreams->isChecked(), ui->actionPublishToSharedMemory->isChecked());
                 // Create CameraView
-                m_cameraViewMap[deviceNumber] = new CameraView(deviceNumber, m_sharedImageBuffer, ui->tabWidget);
+                m_cameraViewMap[deviceNumber] = new CameraView(deviceNumber, m_sharedImageBuffer, m_httpServer, m_imageEncoderPool, m_metricsRegistry, ui->tabWidget);
 
                 // Check if stream synchronization is enabled
                 if(ui->actionSynchronizeStreams->isChecked())
@@ -134,7 +171,8 @@ void MainWindow::connectToCamera()
                                                cameraConnectDialog->getProcessingThreadPrio(),
                                                cameraConnectDialog->getEnableFrameProcessingCheckBoxState(),
                                                cameraConnectDialog->getResolutionWidth(),
-                                               cameraConnectDialog->getResolutionHeight()))
+                                               cameraConnectDialog->getResolutionHeight(),
+                                               cameraConnectDialog->getStreamOptions()))
                 {
                     // Add to map
                     m_deviceNumberMap[deviceNumber] = nextTabIndex;
@@ -296,3 +334,74 @@ void MainWindow::setFullScreen(bool input)
         showNormal();
     }
 }
+
+void MainWindow::setHttpServerEnabled(bool enable)
+{
+    // Served at /stream/<device number>
+    m_httpServer->setStreamsEnabled(enable);
+    if(!updateHttpServerState())
+    {
+        ui->actionServeStreamsOverHttp->setChecked(false);
+    }
+    else if(enable)
+    {
+        ui->statusBar->showMessage(tr("Serving streams at http://%1:%2/stream/<device number>").arg(HTTP_SERVER_ADDRESS).arg(HTTP_SERVER_PORT));
+    }
+    else
+    {
+        ui->statusBar->clearMessage();
+    }
+}
+
+void MainWindow::setHttpMetricsEnabled(bool enable)
+{
+    // Served at /metrics
+    m_httpServer->setMetricsEnabled(enable);
+    if(!updateHttpServerState())
+    {
+        ui->actionServeMetricsOverHttp->setChecked(false);
+    }
+    else if(enable)
+    {
+        ui->statusBar->showMessage(tr("Serving metrics at http://%1:%2/metrics").arg(HTTP_SERVER_ADDRESS).arg(HTTP_SERVER_PORT));
+    }
+    else
+    {
+        ui->statusBar->clearMessage();
+    }
+}
+
+bool MainWindow::updateHttpServerState()
+{
+    // Server runs while streams and/or metrics are served
+    bool isServerNeeded = ui->actionServeStreamsOverHttp->isChecked() || ui->actionServeMetricsOverHttp->isChecked();
+    if(isServerNeeded && !m_httpServer->isRunning())
+    {
+        // Start server
+        if(!m_httpServer->start())
+        {
+            QMessageBox::warning(this, APP_NAME, QString("%1\n\n%2").arg(tr("Could not start HTTP server.")).arg(tr("Check that %1:%2 is available.").arg(HTTP_SERVER_ADDRESS).arg(HTTP_SERVER_PORT)));
+            return false;
+        }
+    }
+    else if(!isServerNeeded && m_httpServer->isRunning())
+    {
+        // Stop server
+        m_httpServer->stop();
+    }
+    return true;
+}
+
+void MainWindow::setFrameMemoryBudget()
+{
+    bool ok;
+    FrameMemoryBudget *frameMemoryBudget = m_sharedImageBuffer->getFrameMemoryBudget();
+    int budget = QInputDialog::getInt(this,
+        tr("Frame Memory Budget"),
+        QString("%1\n%2").arg(tr("Memory available to the image buffers of all streams (MB).")).arg(tr("0 = unlimited. Currently in use: %1 MB.").arg(frameMemoryBudget->getTotalUsage() / (1024 * 1024))),
+        (int)(frameMemoryBudget->getBudget() / (1024 * 1024)), 0, 1024 * 1024, 1, &ok);
+    if(ok)
+    {
+        frameMemoryBudget->setBudget((qint64)budget * 1024 * 1024);
+    }
+}
@@ -43,6 +43,9 @@ namespace Ui {
 class SharedImageBuffer;
 class CameraView;
 class QPushButton;
+class HttpServer;
+class ImageEncoderPool;
+class MetricsRegistry;
 
 class MainWindow : public QMainWindow
 {
@@ -56,17 +59,24 @@ class MainWindow : public QMainWindow
         bool removeFromMapByTabIndex(QMap<int, int>& map, int tabIndex);
         void updateMapValues(QMap<int, int>& map, int tabIndex);
         void setTabCloseToolTips(QTabWidget *tabs, QString tooltip);
+        bool updateHttpServerState();
         Ui::MainWindow *ui;
         QPushButton *m_connectToCameraButton;
         QMap<int, int> m_deviceNumberMap;
         QMap<int, CameraView*> m_cameraViewMap;
         SharedImageBuffer *m_sharedImageBuffer;
+        ImageEncoderPool *m_imageEncoderPool;
+        MetricsRegistry *m_metricsRegistry;
+        HttpServer *m_httpServer;
 
     public slots:
         void connectToCamera();
         void disconnectCamera(int index);
         void showAboutDialog();
         void setFullScreen(bool enable);
+        void setHttpServerEnabled(bool enable);
+        void setHttpMetricsEnabled(bool enable);
+        void setFrameMemoryBudget();
 };
 
 #endif // MAINWINDOW_H
@@ -49,7 +49,8 @@ QImage MatToQImage(const cv::Mat& mat)
         const unsigned char *qImageBuffer = (const unsigned char*)mat.data;
         QImage img(qImageBuffer, mat.cols, mat.rows, (int)mat.step, QImage::Format_Indexed8);
         img.setColorTable(colorTable);
-        return img;
+        // Deep copy: the Mat is reused for later frames (see ScratchArena) while the QImage is still used by the GUI thread
+        return img.copy();
     }
     else if(mat.type() == CV_8UC3)
     {
@@ -0,0 +1,298 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* PerformanceGraph.cpp                                                 */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "PerformanceGraph.h"
+
+#include "Timestamp.h"
+#include "Config.h"
+
+#include <QPainter>
+
+#include <cmath>
+
+// Space between plots (pixels)
+#define PLOT_SPACING                        4
+
+static const char *stageNames[N_STAGE_TIMES] = { "Convert", "Grayscale", "Smooth", "Dilate", "Erode", "Flip", "Canny", "Display" };
+static const QColor stageColors[N_STAGE_TIMES] = { QColor(128, 128, 128), QColor(64, 64, 64), QColor(31, 119, 180), QColor(44, 160, 44),
+                                                   QColor(148, 103, 189), QColor(140, 86, 75), QColor(255, 127, 14), QColor(23, 190, 207) };
+
+PerformanceGraph::PerformanceGraph(QWidget *parent) :
+    QWidget(parent)
+{
+    m_captureRing = 0;
+    m_processingRing = 0;
+    m_captureReadPosition = 0;
+    m_processingReadPosition = 0;
+    m_bufferSize = 1;
+    setMinimumHeight(160);
+    // Repaint at a low rate (samples of all frames since the last update are read at once)
+    m_updateTimer.setInterval(PERFORMANCE_GRAPH_UPDATE_INTERVAL);
+    connect(&m_updateTimer, &QTimer::timeout, this, &PerformanceGraph::updateSamples);
+}
+
+void PerformanceGraph::setSources(const StatsRing<PerformanceSample> *captureRing, const StatsRing<PerformanceSample> *processingRing, int bufferSize)
+{
+    m_captureRing = captureRing;
+    m_processingRing = processingRing;
+    m_captureReadPosition = 0;
+    m_processingReadPosition = 0;
+    m_captureSamples.clear();
+    m_processingSamples.clear();
+    m_bufferSize = qMax(bufferSize, 1);
+}
+
+QSize PerformanceGraph::sizeHint() const
+{
+    return QSize(400, 240);
+}
+
+void PerformanceGraph::updateSamples()
+{
+    if ((m_captureRing == 0) || (m_processingRing == 0))
+    {
+        return;
+    }
+    // Take new samples from rings
+    m_captureRing->read(&m_captureReadPosition, m_captureSamples);
+    m_processingRing->read(&m_processingReadPosition, m_processingSamples);
+    // Remove samples which are no longer shown
+    qint64 startTime = currentTimestamp() - PERFORMANCE_GRAPH_HISTORY * 1000;
+    int nOld = 0;
+    while ((nOld < m_captureSamples.size()) && (m_captureSamples.at(nOld).timestamp < startTime))
+    {
+        nOld++;
+    }
+    m_captureSamples.remove(0, nOld);
+    nOld = 0;
+    while ((nOld < m_processingSamples.size()) && (m_processingSamples.at(nOld).timestamp < startTime))
+    {
+        nOld++;
+    }
+    m_processingSamples.remove(0, nOld);
+    update();
+}
+
+void PerformanceGraph::showEvent(QShowEvent *ev)
+{
+    QWidget::showEvent(ev);
+    updateSamples();
+    m_updateTimer.start();
+}
+
+void PerformanceGraph::hideEvent(QHideEvent *ev)
+{
+    QWidget::hideEvent(ev);
+    m_updateTimer.stop();
+}
+
+void PerformanceGraph::paintEvent(QPaintEvent *ev)
+{
+    Q_UNUSED(ev);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+    QFont font = painter.font();
+    font.setPointSize(7);
+    painter.setFont(font);
+    int nColumns = width();
+    int plotHeight = (height() - 3 * PLOT_SPACING) / 4;
+    if ((nColumns <= 0) || (plotHeight <= 0))
+    {
+        return;
+    }
+    QRect captureRect(0, 0, nColumns, plotHeight);
+    QRect processingRect(0, plotHeight + PLOT_SPACING, nColumns, plotHeight);
+    QRect bufferRect(0, 2 * (plotHeight + PLOT_SPACING), nColumns, plotHeight);
+    QRect dropsRect(0, 3 * (plotHeight + PLOT_SPACING), nColumns, plotHeight);
+
+    // Worst frame of each pixel column (time slice)
+    qint64 endTime = currentTimestamp();
+    qint64 timeSpan = PERFORMANCE_GRAPH_HISTORY * 1000;
+    qint64 startTime = endTime - timeSpan;
+    QVector<float> captureIntervals(nColumns, -1.0f);
+    QVector<int> bufferOccupancies(nColumns, -1);
+    QVector<int> drops(nColumns, 0);
+    QVector<int> worstProcessingSamples(nColumns, -1);
+    QVector<float> processingTimes(nColumns, -1.0f);
+    float maxCaptureInterval = 0.0f;
+    float maxProcessingTime = 0.0f;
+    int maxDrops = 0;
+    for (int i = 0; i < m_captureSamples.size(); i++)
+    {
+        const PerformanceSample &sample = m_captureSamples.at(i);
+        int column = (int)((sample.timestamp - startTime) * nColumns / timeSpan);
+        if ((column < 0) || (column >= nColumns))
+        {
+            continue;
+        }
+        captureIntervals[column] = qMax(captureIntervals[column], sample.captureInterval);
+        bufferOccupancies[column] = qMax(bufferOccupancies[column], sample.bufferOccupancy);
+        if (i > 0)
+        {
+            drops[column] += sample.nFramesDropped - m_captureSamples.at(i - 1).nFramesDropped;
+        }
+        maxCaptureInterval = qMax(maxCaptureInterval, sample.captureInterval);
+    }
+    for (int i = 0; i < m_processingSamples.size(); i++)
+    {
+        const PerformanceSample &sample = m_processingSamples.at(i);
+        int column = (int)((sample.timestamp - startTime) * nColumns / timeSpan);
+        if ((column < 0) || (column >= nColumns))
+        {
+            continue;
+        }
+        float processingTime = 0.0f;
+        for (int stage = 0; stage < N_STAGE_TIMES; stage++)
+        {
+            processingTime += sample.stageTimes[stage];
+        }
+        if (processingTime > processingTimes[column])
+        {
+            processingTimes[column] = processingTime;
+            worstProcessingSamples[column] = i;
+        }
+        if (i > 0)
+        {
+            drops[column] += sample.nFramesDropped - m_processingSamples.at(i - 1).nFramesDropped;
+        }
+        maxProcessingTime = qMax(maxProcessingTime, processingTime);
+    }
+    for (int column = 0; column < nColumns; column++)
+    {
+        maxDrops = qMax(maxDrops, drops[column]);
+    }
+
+    // Capture interval
+    double captureScale = getScaleMax(maxCaptureInterval);
+    painter.setPen(QColor(31, 119, 180));
+    for (int column = 0; column < nColumns; column++)
+    {
+        if (captureIntervals[column] >= 0.0f)
+        {
+            int y = captureRect.bottom() - (int)(captureIntervals[column] / captureScale * (captureRect.height() - 1));
+            painter.drawLine(column, captureRect.bottom(), column, qMax(y, captureRect.top()));
+        }
+    }
+    drawFrame(painter, captureRect, tr("Capture interval"), captureScale, "ms");
+
+    // Processing time per stage (stacked)
+    double processingScale = getScaleMax(maxProcessingTime);
+    for (int column = 0; column < nColumns; column++)
+    {
+        if (worstProcessingSamples[column] == -1)
+        {
+            continue;
+        }
+        const PerformanceSample &sample = m_processingSamples.at(worstProcessingSamples[column]);
+        float stackedTime = 0.0f;
+        for (int stage = 0; stage < N_STAGE_TIMES; stage++)
+        {
+            if (sample.stageTimes[stage] <= 0.0f)
+            {
+                continue;
+            }
+            int y1 = processingRect.bottom() - (int)(stackedTime / processingScale * (processingRect.height() - 1));
+            stackedTime += sample.stageTimes[stage];
+            int y2 = processingRect.bottom() - (int)(stackedTime / processingScale * (processingRect.height() - 1));
+            painter.setPen(stageColors[stage]);
+            painter.drawLine(column, y1, column, qMax(y2, processingRect.top()));
+        }
+    }
+    drawFrame(painter, processingRect, tr("Processing time"), processingScale, "ms");
+    // Legend of stages
+    int x = processingRect.right() - 4;
+    for (int stage = N_STAGE_TIMES - 1; stage >= 0; stage--)
+    {
+        QString name(stageNames[stage]);
+        x -= painter.fontMetrics().width(name) + 6;
+        painter.setPen(stageColors[stage]);
+        painter.drawText(x, processingRect.top() + painter.fontMetrics().ascent() + 2, name);
+    }
+
+    // Image buffer occupancy
+    painter.setPen(QColor(44, 160, 44));
+    for (int column = 0; column < nColumns; column++)
+    {
+        if (bufferOccupancies[column] > 0)
+        {
+            int y = bufferRect.bottom() - (int)((double)bufferOccupancies[column] / m_bufferSize * (bufferRect.height() - 1));
+            painter.drawLine(column, bufferRect.bottom(), column, qMax(y, bufferRect.top()));
+        }
+    }
+    drawFrame(painter, bufferRect, tr("Image buffer"), m_bufferSize, tr("frames"));
+
+    // Dropped frames (capture: buffer full, processing: stale, superseded or late)
+    double dropsScale = getScaleMax(maxDrops);
+    painter.setPen(QColor(214, 39, 40));
+    for (int column = 0; column < nColumns; column++)
+    {
+        if (drops[column] > 0)
+        {
+            int y = dropsRect.bottom() - (int)(drops[column] / dropsScale * (dropsRect.height() - 1));
+            painter.drawLine(column, dropsRect.bottom(), column, qMax(y, dropsRect.top()));
+        }
+    }
+    drawFrame(painter, dropsRect, tr("Dropped frames"), dropsScale, tr("frames"));
+}
+
+void PerformanceGraph::drawFrame(QPainter &painter, const QRect &rect, const QString &title, double maxValue, const QString &unit)
+{
+    // Border, title (top left) and value at top of plot
+    painter.setPen(palette().color(QPalette::Mid));
+    painter.drawRect(rect.adjusted(0, 0, -1, -1));
+    painter.setPen(palette().color(QPalette::Text));
+    int y = rect.top() + painter.fontMetrics().ascent() + 2;
+    painter.drawText(rect.left() + 4, y, QString("%1 (%2 %3)").arg(title).arg(maxValue).arg(unit));
+}
+
+double PerformanceGraph::getScaleMax(double value)
+{
+    // Smallest of 1, 2, 5, 10, 20, 50, ... which is not below value
+    if (value <= 1.0)
+    {
+        return 1.0;
+    }
+    double magnitude = std::pow(10.0, std::floor(std::log10(value)));
+    if (value <= magnitude)
+    {
+        return magnitude;
+    }
+    if (value <= 2.0 * magnitude)
+    {
+        return 2.0 * magnitude;
+    }
+    if (value <= 5.0 * magnitude)
+    {
+        return 5.0 * magnitude;
+    }
+    return 10.0 * magnitude;
+}
@@ -0,0 +1,77 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* PerformanceGraph.h                                                   */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef PERFORMANCEGRAPH_H
+#define PERFORMANCEGRAPH_H
+
+#include <QWidget>
+#include <QTimer>
+#include <QVector>
+
+#include "Structures.h"
+#include "StatsRing.h"
+
+// Rolling plots (last PERFORMANCE_GRAPH_HISTORY seconds) of capture interval, processing time per stage, image buffer
+// occupancy and dropped frames. Samples are taken from the performance rings of the capture and processing threads
+// while the widget is visible; each pixel column shows the worst frame of its time slice, so single stutters remain
+// visible.
+class PerformanceGraph : public QWidget
+{
+    Q_OBJECT
+
+    public:
+        PerformanceGraph(QWidget *parent = 0);
+        void setSources(const StatsRing<PerformanceSample> *captureRing, const StatsRing<PerformanceSample> *processingRing, int bufferSize);
+        QSize sizeHint() const;
+
+    private:
+        void drawFrame(QPainter &painter, const QRect &rect, const QString &title, double maxValue, const QString &unit);
+        static double getScaleMax(double value);
+        const StatsRing<PerformanceSample> *m_captureRing;
+        const StatsRing<PerformanceSample> *m_processingRing;
+        quint32 m_captureReadPosition;
+        quint32 m_processingReadPosition;
+        QVector<PerformanceSample> m_captureSamples;
+        QVector<PerformanceSample> m_processingSamples;
+        QTimer m_updateTimer;
+        int m_bufferSize;
+
+    protected:
+        void paintEvent(QPaintEvent *ev);
+        void showEvent(QShowEvent *ev);
+        void hideEvent(QHideEvent *ev);
+
+    private slots:
+        void updateSamples();
+};
+
+#endif // PERFORMANCEGRAPH_H
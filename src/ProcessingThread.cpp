@@ -35,25 +35,60 @@
 #include "SharedImageBuffer.h"
 #include "Buffer.h"
 #include "MatToQImage.h"
+#include "ImageFilters.h"
+#include "Timestamp.h"
+#include "ThreadScheduling.h"
+#include "StreamMetrics.h"
 #include "Config.h"
 
 #include <QDebug>
 
 ProcessingThread::ProcessingThread(SharedImageBuffer *sharedImageBuffer, int deviceNumber) :
     QThread(),
-    m_sharedImageBuffer(sharedImageBuffer)
+    m_sharedImageBuffer(sharedImageBuffer),
+    m_scratchArena(SCRATCH_ARENA_MAX_MATS),
+    m_performanceRing(PERFORMANCE_RING_SIZE),
+    m_adaptiveQualityController(OPTIONAL_PROCESSING_STAGES)
 {
     m_deviceNumber = deviceNumber;
+    m_metrics = 0;
     m_doStop = false;
     m_sampleNumber = 0;
     m_fpsSum = 0;
     m_fps.clear();
     m_statsData.averageFPS = 0;
     m_statsData.nFramesProcessed = 0;
+    m_statsData.nFramesStale = 0;
+    m_statsData.nFramesSuperseded = 0;
+    m_statsData.nFramesLate = 0;
+    m_statsData.nFramesDegraded = 0;
+    m_statsData.frameDecimation = 1;
+    m_statsData.nScratchAllocations = 0;
+    m_statsData.nFramesDropped = 0;
+    m_statsData.latency = -1;
+    m_performanceSample = PerformanceSample();
+    m_stageTimeMark = 0;
+    m_adaptiveQualityEnabled = false;
+    m_nFramesSkipped = 0;
+    m_processingDeadline = 0;
+    m_maxFrameAge = 0;
+    m_rawFormat = 0;
+    m_schedulingData.policy = 0;
+    m_schedulingData.priority = 0;
+    m_deadline = -1;
+    m_isCurrentFrameDegraded = false;
+    m_pipeline = &ProcessingThread::runPipeline<false, false, false, false, false, false>;
+    m_pendingSettings = Settings();
 }
 
 void ProcessingThread::run()
 {
+    // Set CPU affinity and scheduling policy of this thread
+    if (!applyThreadScheduling(m_schedulingData))
+    {
+        qDebug() << "[" << m_deviceNumber << "] WARNING: Could not apply thread scheduling settings.";
+    }
+
     while(1)
     {
         ////////////////////////////////
@@ -75,116 +110,173 @@ void ProcessingThread::run()
         // Start timer (used to calculate processing rate)
         m_t.start();
 
-        m_processingMutex.lock();
-        // Get frame from queue, store in currentFrame, set ROI
-        m_currentFrame = cv::Mat(m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->get().clone(), m_currentROI);
+        // Take settings published by the GUI thread (frame boundary: no lock is held while processing)
+        applySettings();
 
-        // Example of how to grab a frame from another stream (where Device Number=1)
-        // Note: This requires stream synchronization to be ENABLED (in the Options menu of MainWindow) and frame processing for the stream you are grabbing FROM to be DISABLED.
-        /*
-        if(sharedImageBuffer->containsImageBufferForDeviceNumber(1))
+        // Get frame from queue (time spent waiting for a frame is idle time)
+        m_waitTimer.start();
+        // If a maximum frame age is set, only the newest frame is processed (older frames are skipped)
+        qint64 timestamp;
+        cv::Mat frame;
+        bool isFrameStale = false;
+        if (m_maxFrameAge > 0)
         {
-            // Grab frame from another stream (connected to camera with Device Number=1)
-            cv::Mat frameFromAnotherStream = cv::Mat(sharedImageBuffer->getByDeviceNumber(1)->getFrame(), currentROI);
-            // Linear blend images together using OpenCV and save the result to currentFrame. Note: beta = 1 - alpha
-            cv::addWeighted(frameFromAnotherStream, 0.5, currentFrame, 0.5, 0.0, currentFrame);
+            int nStale;
+            int nSuperseded;
+            frame = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->getFresh(m_maxFrameAge, &timestamp, &nStale, &nSuperseded);
+            m_statsData.nFramesStale += nStale;
+            m_statsData.nFramesSuperseded += nSuperseded;
+            isFrameStale = frame.empty();
         }
-        */
+        else
+        {
+            frame = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->get(&timestamp);
+        }
+        qint64 waitTime = m_waitTimer.nsecsElapsed();
+        m_workTimer.start();
+        // Stage times of frame (performance graphs)
+        m_performanceSample = PerformanceSample();
+        m_performanceSample.timestamp = timestamp;
+        m_performanceSample.bufferOccupancy = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber)->size();
+        m_stageTimeMark = 0;
 
-        ////////////////////////////////////
-        // PERFORM IMAGE PROCESSING BELOW //
-        ////////////////////////////////////
-        // Grayscale conversion
-        if (m_imgProcFlags.grayscaleOn && (m_currentFrame.channels() == 3 || m_currentFrame.channels() == 4))
+        // Skipped frames (stale, late or decimated) are not processed, but statistics are still reported
+        if (isFrameStale)
         {
-            cvtColor(m_currentFrame,
-                m_currentFrame,
-                CV_BGR2GRAY);
+            updateStatistics(timestamp, false);
+            continue;
         }
 
-        // Smooth
-        if (m_imgProcFlags.smoothOn)
+        // Processing deadline: discard frame if already too late
+        m_deadline = ((m_processingDeadline > 0) && (timestamp >= 0)) ? timestamp + m_processingDeadline : -1;
+        m_isCurrentFrameDegraded = false;
+        if ((m_deadline != -1) && (currentTimestamp() >= m_deadline))
         {
-            switch (m_imgProcSettings.smoothType)
+            m_statsData.nFramesLate++;
+            if (m_adaptiveQualityEnabled)
             {
-                // Blur
-                case 0:
-                    blur(m_currentFrame,
-                        m_currentFrame,
-                        cv::Size(m_imgProcSettings.smoothParam1, m_imgProcSettings.smoothParam2));
-                    break;
-                // Gaussian
-                case 1:
-                    GaussianBlur(m_currentFrame,
-                        m_currentFrame,
-                        cv::Size(m_imgProcSettings.smoothParam1, m_imgProcSettings.smoothParam2),
-                        m_imgProcSettings.smoothParam3,
-                        m_imgProcSettings.smoothParam4);
-                    break;
-                // Median
-                case 2:
-                    medianBlur(m_currentFrame,
-                        m_currentFrame,
-                        m_imgProcSettings.smoothParam1);
-                    break;
+                updateAdaptiveQuality(waitTime, m_workTimer.nsecsElapsed());
             }
+            updateStatistics(timestamp, false);
+            continue;
         }
-        // Dilate
-        if (m_imgProcFlags.dilateOn)
+
+        // Adaptive quality control: only process every Nth frame
+        if (m_adaptiveQualityEnabled && (++m_nFramesSkipped < m_adaptiveQualityController.getFrameDecimation()))
         {
-            dilate(m_currentFrame,
-                m_currentFrame,
-                cv::Mat(),
-                cv::Point(-1, -1),
-                m_imgProcSettings.dilateNumberOfIterations);
+            updateAdaptiveQuality(waitTime, m_workTimer.nsecsElapsed());
+            updateStatistics(timestamp, false);
+            continue;
         }
-        // Erode
-        if (m_imgProcFlags.erodeOn)
+        m_nFramesSkipped = 0;
+
+        // Adaptive quality control: disable optional stages
+        ImageProcessingFlags imgProcFlags = m_imgProcFlags;
+        if (m_adaptiveQualityEnabled)
         {
-            erode(m_currentFrame,
-                m_currentFrame,
-                cv::Mat(),
-                cv::Point(-1, -1),
-                m_imgProcSettings.erodeNumberOfIterations);
+            imgProcFlags = m_adaptiveQualityController.applyToFlags(m_imgProcFlags);
         }
-        // Flip
-        if (m_imgProcFlags.flipOn)
+
+        // Store ROI of frame in currentFrame (converting raw frames to BGR or grayscale): frames from the image buffer are
+        // not modified, stages render into images from the scratch arena
+        cv::Mat convertedFrame;
+        if ((m_rawFormat != 0) && convertRawFrame(frame, imgProcFlags.grayscaleOn, convertedFrame))
         {
-            flip(m_currentFrame,
-                m_currentFrame,
-                m_imgProcSettings.flipCode);
+            m_currentFrame = convertedFrame(getFrameROI(convertedFrame.size()));
         }
-        // Canny edge detection
-        if (m_imgProcFlags.cannyOn)
+        else
         {
-            Canny(m_currentFrame,
-                m_currentFrame,
-                m_imgProcSettings.cannyThreshold1,
-                m_imgProcSettings.cannyThreshold2,
-                m_imgProcSettings.cannyApertureSize,
-                m_imgProcSettings.cannyL2gradient);
+            cv::Mat roiFrame = frame(getFrameROI(frame.size()));
+            m_currentFrame = m_scratchArena.get(roiFrame.size(), roiFrame.type());
+            roiFrame.copyTo(m_currentFrame);
         }
+        frame.release();
+        convertedFrame.release();
+
+        // Adaptive quality control: downscale frame
+        if (m_adaptiveQualityEnabled && (m_adaptiveQualityController.getScale() != 1.0))
+        {
+            double scale = m_adaptiveQualityController.getScale();
+            cv::Mat scaledFrame = m_scratchArena.get(cv::Size(cvRound(m_currentFrame.cols * scale), cvRound(m_currentFrame.rows * scale)), m_currentFrame.type());
+            cv::resize(m_currentFrame, scaledFrame, scaledFrame.size(), 0, 0, cv::INTER_AREA);
+            m_currentFrame = scaledFrame;
+        }
+        markStageTime(StageTimeConvert);
+
+        // Example of how to grab a frame from another stream (where Device Number=1)
+        // Note: This requires stream synchronization to be ENABLED (in the Options menu of MainWindow) and frame processing for the stream you are grabbing FROM to be DISABLED.
+        /*
+        if(sharedImageBuffer->containsImageBufferForDeviceNumber(1))
+        {
+            // Grab frame from another stream (connected to camera with Device Number=1)
+            cv::Mat frameFromAnotherStream = cv::Mat(sharedImageBuffer->getByDeviceNumber(1)->getFrame(), currentROI);
+            // Linear blend images together using OpenCV and save the result to currentFrame. Note: beta = 1 - alpha
+            cv::addWeighted(frameFromAnotherStream, 0.5, currentFrame, 0.5, 0.0, currentFrame);
+        }
+        */
+
+        ////////////////////////////////////
+        // PERFORM IMAGE PROCESSING BELOW //
+        ////////////////////////////////////
+        // Specialized pipeline for the enabled stages (optional stages are disabled by adaptive quality control)
+        Pipeline pipeline = m_adaptiveQualityEnabled ? getPipeline(imgProcFlags) : m_pipeline;
+        (this->*pipeline)();
         ////////////////////////////////////
         // PERFORM IMAGE PROCESSING ABOVE //
         ////////////////////////////////////
 
         // Convert Mat to QImage
         m_frame = MatToQImage(m_currentFrame);
-        m_processingMutex.unlock();
+        markStageTime(StageTimeDisplay);
 
         // Inform GUI thread of new frame (QImage)
         emit newFrame(m_frame);
+        // Inform other outputs (e.g. HTTP server) of new frame (Mat is shared, not copied)
+        emit newProcessedFrame(m_deviceNumber, m_currentFrame);
+        // Keep reference to frame (e.g. for snapshots)
+        m_lastProcessedFrameMutex.lock();
+        m_lastProcessedFrame = m_currentFrame;
+        m_lastProcessedFrameMutex.unlock();
+
+        // Adaptive quality control: update quality level
+        if (m_adaptiveQualityEnabled)
+        {
+            updateAdaptiveQuality(waitTime, m_workTimer.nsecsElapsed());
+        }
 
         // Update statistics
-        updateFPS(m_processingTime);
-        m_statsData.nFramesProcessed++;
-        // Inform GUI of updated statistics
-        emit updateStatisticsInGUI(m_statsData);
+        updateStatistics(timestamp, true);
     }
 
     qDebug() << "Stopping processing thread...";
 }
 
+void ProcessingThread::updateStatistics(qint64 timestamp, bool isFrameProcessed)
+{
+    // Called once per frame taken from the image buffer (including skipped frames)
+    if (isFrameProcessed)
+    {
+        updateFPS(m_processingTime);
+        m_statsData.nFramesProcessed++;
+        if (m_isCurrentFrameDegraded)
+        {
+            m_statsData.nFramesDegraded++;
+        }
+        m_statsData.latency = (timestamp >= 0) ? (int)(currentTimestamp() - timestamp) : -1;
+    }
+    m_statsData.nScratchAllocations = m_scratchArena.takeAllocationCount();
+    // Record sample for performance graphs (lock-free: read by GUI thread at a low rate)
+    m_performanceSample.nFramesDropped = m_statsData.nFramesStale + m_statsData.nFramesSuperseded + m_statsData.nFramesLate;
+    m_performanceRing.push(m_performanceSample);
+    // Export metrics (if enabled)
+    if (m_metrics != 0)
+    {
+        m_metrics->updateProcessing(m_statsData, m_performanceSample, isFrameProcessed);
+    }
+    // Inform GUI of updated statistics
+    emit updateStatisticsInGUI(m_statsData);
+}
+
 void ProcessingThread::updateFPS(int timeElapsed)
 {
     // Add instantaneous FPS value to queue
@@ -218,6 +310,228 @@ void ProcessingThread::updateFPS(int timeElapsed)
     }
 }
 
+void ProcessingThread::updateAdaptiveQuality(qint64 waitTime, qint64 workTime)
+{
+    Buffer<cv::Mat> *imageBuffer = m_sharedImageBuffer->getByDeviceNumber(m_deviceNumber);
+    double bufferOccupancy = (double)imageBuffer->size() / (double)imageBuffer->maxSize();
+    double utilization = (waitTime + workTime > 0) ? (double)workTime / (double)(waitTime + workTime) : 0.0;
+
+    QMutexLocker locker(&m_adaptiveQualityMutex);
+    if (m_adaptiveQualityController.update(bufferOccupancy, utilization))
+    {
+        QualityLevelChangeData event = m_adaptiveQualityController.getEventLog().last();
+        qDebug() << "[" << m_deviceNumber << "] Quality level changed:" << event.previousLevel << "->" << event.level
+                 << "(buffer occupancy:" << event.bufferOccupancy << ", utilization:" << event.utilization << ")";
+        // Inform GUI of new quality level
+        emit qualityLevelChanged(event);
+    }
+}
+
+// Processing stages of one combination of image processing flags. Flags are template parameters: stages which are
+// disabled are removed at compile time (no per-frame branching), and fused implementations are used where the
+// combination permits.
+template<bool grayscaleOn, bool smoothOn, bool dilateOn, bool erodeOn, bool flipOn, bool cannyOn>
+void ProcessingThread::runPipeline()
+{
+    // Optional stages are skipped if they would not complete before the processing deadline (see beginOptionalStage)
+    // Fused grayscale + blur + Canny (common preset): single pass over the frame, the separate stages are then skipped
+    bool isFused = false;
+    if (grayscaleOn && smoothOn && !dilateOn && !erodeOn && !flipOn && cannyOn &&
+        (m_imgProcSettings.smoothType == 0) && (m_imgProcSettings.cannyApertureSize == 3) &&
+        beginOptionalStage(AdaptiveQualityController::SmoothStage | AdaptiveQualityController::CannyStage))
+    {
+        cv::Mat edgeFrame = getScratchFrame(CV_8UC1);
+        grayBlurCanny(m_currentFrame,
+            edgeFrame,
+            cv::Size(m_imgProcSettings.smoothParam1, m_imgProcSettings.smoothParam2),
+            m_imgProcSettings.cannyThreshold1,
+            m_imgProcSettings.cannyThreshold2,
+            m_imgProcSettings.cannyL2gradient);
+        m_currentFrame = edgeFrame;
+        endOptionalStage(AdaptiveQualityController::SmoothStage | AdaptiveQualityController::CannyStage);
+        markStageTime(StageTimeCanny);
+        isFused = true;
+    }
+    // Grayscale conversion
+    if (grayscaleOn && !isFused && (m_currentFrame.channels() == 3 || m_currentFrame.channels() == 4))
+    {
+        cv::Mat grayFrame = getScratchFrame(CV_8UC1);
+        bgrToGray(m_currentFrame,
+            grayFrame);
+        m_currentFrame = grayFrame;
+        markStageTime(StageTimeGrayscale);
+    }
+
+    // Smooth
+    if (smoothOn && !isFused && beginOptionalStage(AdaptiveQualityController::SmoothStage))
+    {
+        cv::Mat smoothedFrame = getScratchFrame(m_currentFrame.type());
+        switch (m_imgProcSettings.smoothType)
+        {
+            // Blur
+            case 0:
+                boxBlur(m_currentFrame,
+                    smoothedFrame,
+                    cv::Size(m_imgProcSettings.smoothParam1, m_imgProcSettings.smoothParam2));
+                break;
+            // Gaussian
+            case 1:
+                GaussianBlur(m_currentFrame,
+                    smoothedFrame,
+                    cv::Size(m_imgProcSettings.smoothParam1, m_imgProcSettings.smoothParam2),
+                    m_imgProcSettings.smoothParam3,
+                    m_imgProcSettings.smoothParam4);
+                break;
+            // Median
+            case 2:
+                medianBlur(m_currentFrame,
+                    smoothedFrame,
+                    m_imgProcSettings.smoothParam1);
+                break;
+        }
+        m_currentFrame = smoothedFrame;
+        endOptionalStage(AdaptiveQualityController::SmoothStage);
+        markStageTime(StageTimeSmooth);
+    }
+    // Dilate
+    if (dilateOn && beginOptionalStage(AdaptiveQualityController::DilateStage))
+    {
+        cv::Mat dilatedFrame = getScratchFrame(m_currentFrame.type());
+        dilateRect(m_currentFrame,
+            dilatedFrame,
+            m_imgProcSettings.dilateNumberOfIterations);
+        m_currentFrame = dilatedFrame;
+        endOptionalStage(AdaptiveQualityController::DilateStage);
+        markStageTime(StageTimeDilate);
+    }
+    // Erode
+    if (erodeOn && beginOptionalStage(AdaptiveQualityController::ErodeStage))
+    {
+        cv::Mat erodedFrame = getScratchFrame(m_currentFrame.type());
+        erodeRect(m_currentFrame,
+            erodedFrame,
+            m_imgProcSettings.erodeNumberOfIterations);
+        m_currentFrame = erodedFrame;
+        endOptionalStage(AdaptiveQualityController::ErodeStage);
+        markStageTime(StageTimeErode);
+    }
+    // Flip
+    if (flipOn)
+    {
+        cv::Mat flippedFrame = getScratchFrame(m_currentFrame.type());
+        flipImage(m_currentFrame,
+            flippedFrame,
+            m_imgProcSettings.flipCode);
+        m_currentFrame = flippedFrame;
+        markStageTime(StageTimeFlip);
+    }
+    // Canny edge detection
+    if (cannyOn && !isFused && beginOptionalStage(AdaptiveQualityController::CannyStage))
+    {
+        cv::Mat edgeFrame = getScratchFrame(CV_8UC1);
+        Canny(m_currentFrame,
+            edgeFrame,
+            m_imgProcSettings.cannyThreshold1,
+            m_imgProcSettings.cannyThreshold2,
+            m_imgProcSettings.cannyApertureSize,
+            m_imgProcSettings.cannyL2gradient);
+        m_currentFrame = edgeFrame;
+        endOptionalStage(AdaptiveQualityController::CannyStage);
+        markStageTime(StageTimeCanny);
+    }
+}
+
+// Pipeline index: one bit per stage (in processing order)
+#define PIPELINE(index) &ProcessingThread::runPipeline<((index) & 0x1) != 0, ((index) & 0x2) != 0, ((index) & 0x4) != 0, ((index) & 0x8) != 0, ((index) & 0x10) != 0, ((index) & 0x20) != 0>
+#define PIPELINES_4(index) PIPELINE(index), PIPELINE(index + 1), PIPELINE(index + 2), PIPELINE(index + 3)
+#define PIPELINES_16(index) PIPELINES_4(index), PIPELINES_4(index + 4), PIPELINES_4(index + 8), PIPELINES_4(index + 12)
+
+ProcessingThread::Pipeline ProcessingThread::getPipeline(const ImageProcessingFlags &imgProcFlags)
+{
+    static const Pipeline pipelines[64] = { PIPELINES_16(0), PIPELINES_16(16), PIPELINES_16(32), PIPELINES_16(48) };
+    int index = (imgProcFlags.grayscaleOn ? 0x1 : 0) |
+        (imgProcFlags.smoothOn ? 0x2 : 0) |
+        (imgProcFlags.dilateOn ? 0x4 : 0) |
+        (imgProcFlags.erodeOn ? 0x8 : 0) |
+        (imgProcFlags.flipOn ? 0x10 : 0) |
+        (imgProcFlags.cannyOn ? 0x20 : 0);
+    return pipelines[index];
+}
+
+bool ProcessingThread::convertRawFrame(const cv::Mat &frame, bool toGrayscale, cv::Mat &convertedFrame)
+{
+    int type = toGrayscale ? CV_8UC1 : CV_8UC3;
+    // Motion JPEG: frame is the compressed image (single row), decoded into image of size of previous frame (reallocated by imdecode if size changed)
+    if ((m_rawFormat == cv::VideoWriter::fourcc('M', 'J', 'P', 'G')) && (frame.rows == 1))
+    {
+        if (m_decodedFrameSize.area() > 0)
+        {
+            convertedFrame = m_scratchArena.get(m_decodedFrameSize, type);
+        }
+        cv::imdecode(frame, toGrayscale ? cv::IMREAD_GRAYSCALE : cv::IMREAD_COLOR, &convertedFrame);
+        m_decodedFrameSize = convertedFrame.size();
+        return !convertedFrame.empty();
+    }
+    // YUYV (YUV 4:2:2): luminance is channel 0 of the 2-channel frame
+    else if ((m_rawFormat == cv::VideoWriter::fourcc('Y', 'U', 'Y', 'V')) && (frame.type() == CV_8UC2))
+    {
+        convertedFrame = m_scratchArena.get(frame.size(), type);
+        if (toGrayscale)
+        {
+            cv::extractChannel(frame, convertedFrame, 0);
+        }
+        else
+        {
+            cv::cvtColor(frame, convertedFrame, cv::COLOR_YUV2BGR_YUYV);
+        }
+        return true;
+    }
+    // Other formats (e.g. GREY) are used as they are
+    return false;
+}
+
+cv::Mat ProcessingThread::getScratchFrame(int type)
+{
+    // Image of size of current frame which is not referenced elsewhere (i.e. not the current frame itself)
+    return m_scratchArena.get(m_currentFrame.size(), type);
+}
+
+bool ProcessingThread::beginOptionalStage(int stage)
+{
+    // Stage is not optional or no deadline: always run stage
+    if (!(OPTIONAL_PROCESSING_STAGES & stage) || (m_deadline == -1))
+    {
+        return true;
+    }
+    // Skip stage if it is not expected to complete before the deadline (frame is marked as degraded)
+    if (currentTimestamp() + (qint64)m_stageTimeMap.value(stage, 0.0) > m_deadline)
+    {
+        m_isCurrentFrameDegraded = true;
+        return false;
+    }
+    m_stageTimer.start();
+    return true;
+}
+
+void ProcessingThread::endOptionalStage(int stage)
+{
+    if ((OPTIONAL_PROCESSING_STAGES & stage) && (m_deadline != -1))
+    {
+        // Update estimate of stage time (exponential moving average)
+        double stageTime = (double)m_stageTimer.nsecsElapsed() / 1000000.0;
+        double estimate = m_stageTimeMap.value(stage, stageTime);
+        m_stageTimeMap[stage] = estimate + PROCESSING_STAGE_TIME_SMOOTHING * (stageTime - estimate);
+    }
+}
+
+void ProcessingThread::markStageTime(int stage)
+{
+    // Time since end of previous stage is attributed to stage
+    qint64 now = m_workTimer.nsecsElapsed();
+    m_performanceSample.stageTimes[stage] += (now - m_stageTimeMark) / 1000000.0f;
+    m_stageTimeMark = now;
+}
+
 void ProcessingThread::stop()
 {
     QMutexLocker locker(&m_doStopMutex);
@@ -226,42 +540,144 @@ void ProcessingThread::stop()
 
 void ProcessingThread::updateImageProcessingFlags(ImageProcessingFlags imgProcFlags)
 {
-    QMutexLocker locker(&m_processingMutex);
-    m_imgProcFlags.grayscaleOn = imgProcFlags.grayscaleOn;
-    m_imgProcFlags.smoothOn = imgProcFlags.smoothOn;
-    m_imgProcFlags.dilateOn=imgProcFlags.dilateOn;
-    m_imgProcFlags.erodeOn=imgProcFlags.erodeOn;
-    m_imgProcFlags.flipOn=imgProcFlags.flipOn;
-    m_imgProcFlags.cannyOn=imgProcFlags.cannyOn;
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.imgProcFlags = imgProcFlags;
+    publishSettings();
 }
 
 void ProcessingThread::updateImageProcessingSettings(ImageProcessingSettings imgProcSettings)
 {
-    QMutexLocker locker(&m_processingMutex);
-    m_imgProcSettings.smoothType=imgProcSettings.smoothType;
-    m_imgProcSettings.smoothParam1=imgProcSettings.smoothParam1;
-    m_imgProcSettings.smoothParam2=imgProcSettings.smoothParam2;
-    m_imgProcSettings.smoothParam3=imgProcSettings.smoothParam3;
-    m_imgProcSettings.smoothParam4=imgProcSettings.smoothParam4;
-    m_imgProcSettings.dilateNumberOfIterations=imgProcSettings.dilateNumberOfIterations;
-    m_imgProcSettings.erodeNumberOfIterations=imgProcSettings.erodeNumberOfIterations;
-    m_imgProcSettings.flipCode=imgProcSettings.flipCode;
-    m_imgProcSettings.cannyThreshold1=imgProcSettings.cannyThreshold1;
-    m_imgProcSettings.cannyThreshold2=imgProcSettings.cannyThreshold2;
-    m_imgProcSettings.cannyApertureSize=imgProcSettings.cannyApertureSize;
-    m_imgProcSettings.cannyL2gradient=imgProcSettings.cannyL2gradient;
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.imgProcSettings = imgProcSettings;
+    publishSettings();
 }
 
 void ProcessingThread::setROI(QRect roi)
 {
-    QMutexLocker locker(&m_processingMutex);
-    m_currentROI.x = roi.x();
-    m_currentROI.y = roi.y();
-    m_currentROI.width = roi.width();
-    m_currentROI.height = roi.height();
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.roi = cv::Rect(roi.x(), roi.y(), roi.width(), roi.height());
+    publishSettings();
+}
+
+const StatsRing<PerformanceSample> *ProcessingThread::getPerformanceRing()
+{
+    return &m_performanceRing;
 }
 
 QRect ProcessingThread::getCurrentROI()
 {
-    return QRect(m_currentROI.x, m_currentROI.y, m_currentROI.width, m_currentROI.height);
+    // Latest ROI set (applied by the processing thread from the next frame on)
+    QMutexLocker locker(&m_settingsMutex);
+    return QRect(m_pendingSettings.roi.x, m_pendingSettings.roi.y, m_pendingSettings.roi.width, m_pendingSettings.roi.height);
+}
+
+void ProcessingThread::setProcessingDeadline(int deadline)
+{
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.processingDeadline = deadline;
+    publishSettings();
+}
+
+void ProcessingThread::setMaxFrameAge(int maxFrameAge)
+{
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.maxFrameAge = maxFrameAge;
+    publishSettings();
+}
+
+void ProcessingThread::setRawFormat(int fourcc)
+{
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.rawFormat = fourcc;
+    publishSettings();
+}
+
+void ProcessingThread::setInputSourceSize(int width, int height)
+{
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.inputSourceSize = cv::Size(width, height);
+    publishSettings();
+}
+
+cv::Rect ProcessingThread::getFrameROI(const cv::Size &frameSize)
+{
+    // ROI is set in input source coordinates: scale it to frames of other size (e.g. downscaled by the image buffer under
+    // memory pressure) and clamp it to the frame
+    cv::Rect roi = m_currentROI;
+    if ((m_inputSourceSize.width > 0) && (m_inputSourceSize.height > 0) && (frameSize != m_inputSourceSize))
+    {
+        double scaleX = (double)frameSize.width / m_inputSourceSize.width;
+        double scaleY = (double)frameSize.height / m_inputSourceSize.height;
+        roi = cv::Rect(cvFloor(roi.x * scaleX), cvFloor(roi.y * scaleY), cvRound(roi.width * scaleX), cvRound(roi.height * scaleY));
+    }
+    roi &= cv::Rect(cv::Point(0, 0), frameSize);
+    // Whole frame if nothing of ROI is left
+    if (roi.area() == 0)
+    {
+        roi = cv::Rect(cv::Point(0, 0), frameSize);
+    }
+    return roi;
+}
+
+void ProcessingThread::publishSettings()
+{
+    // Called with m_settingsMutex locked (serializes writers, never locked by the processing loop)
+    m_settingsBuffer.write() = m_pendingSettings;
+    m_settingsBuffer.publish();
+}
+
+void ProcessingThread::applySettings()
+{
+    if (!m_settingsBuffer.update())
+    {
+        return;
+    }
+    const Settings &settings = m_settingsBuffer.read();
+    m_imgProcFlags = settings.imgProcFlags;
+    m_imgProcSettings = settings.imgProcSettings;
+    m_currentROI = settings.roi;
+    m_inputSourceSize = settings.inputSourceSize;
+    m_processingDeadline = settings.processingDeadline;
+    m_maxFrameAge = settings.maxFrameAge;
+    m_rawFormat = settings.rawFormat;
+    m_pipeline = getPipeline(m_imgProcFlags);
+    // Adaptive quality control restarts at full quality when enabled
+    if (settings.adaptiveQualityEnabled != m_adaptiveQualityEnabled)
+    {
+        QMutexLocker locker(&m_adaptiveQualityMutex);
+        m_adaptiveQualityController.reset();
+        m_nFramesSkipped = 0;
+    }
+    m_adaptiveQualityEnabled = settings.adaptiveQualityEnabled;
+}
+
+void ProcessingThread::setScheduling(const ThreadSchedulingData &schedulingData)
+{
+    // Must be called before start()
+    m_schedulingData = schedulingData;
+}
+
+void ProcessingThread::setAdaptiveQualityEnabled(bool enable)
+{
+    QMutexLocker locker(&m_settingsMutex);
+    m_pendingSettings.adaptiveQualityEnabled = enable;
+    publishSettings();
+}
+
+void ProcessingThread::setMetrics(StreamMetrics *metrics)
+{
+    // Must be called before the thread is started (metrics must outlive the thread)
+    m_metrics = metrics;
+}
+
+QList<QualityLevelChangeData> ProcessingThread::getQualityLevelChangeLog()
+{
+    QMutexLocker locker(&m_adaptiveQualityMutex);
+    return m_adaptiveQualityController.getEventLog();
+}
+
+cv::Mat ProcessingThread::getLastProcessedFrame()
+{
+    QMutexLocker locker(&m_lastProcessedFrameMutex);
+    return m_lastProcessedFrame;
 }
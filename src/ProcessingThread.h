@@ -35,14 +35,21 @@
 
 #include <QThread>
 #include <QTime>
+#include <QElapsedTimer>
 #include <QQueue>
 #include <QImage>
+#include <QHash>
 
 #include <opencv2/opencv.hpp>
 
 #include "Structures.h"
+#include "AdaptiveQualityController.h"
+#include "TripleBuffer.h"
+#include "ScratchArena.h"
+#include "StatsRing.h"
 
 class SharedImageBuffer;
+class StreamMetrics;
 
 class ProcessingThread : public QThread
 {
@@ -51,25 +58,87 @@ class ProcessingThread : public QThread
     public:
         ProcessingThread(SharedImageBuffer *sharedImageBuffer, int deviceNumber);
         QRect getCurrentROI();
+        cv::Mat getLastProcessedFrame();
+        void setProcessingDeadline(int deadline);
+        void setMaxFrameAge(int maxFrameAge);
+        void setRawFormat(int fourcc);
+        void setInputSourceSize(int width, int height);
+        void setScheduling(const ThreadSchedulingData &schedulingData);
+        void setAdaptiveQualityEnabled(bool enable);
+        void setMetrics(StreamMetrics *metrics);
+        QList<QualityLevelChangeData> getQualityLevelChangeLog();
+        const StatsRing<PerformanceSample> *getPerformanceRing();
         void stop();
 
     private:
+        typedef void (ProcessingThread::*Pipeline)();
+        // Settings set by the GUI thread, handed to the processing loop at frame boundaries
+        typedef struct
+        {
+            ImageProcessingFlags imgProcFlags;
+            ImageProcessingSettings imgProcSettings;
+            cv::Rect roi;
+            cv::Size inputSourceSize;
+            int processingDeadline;
+            int maxFrameAge;
+            int rawFormat;
+            bool adaptiveQualityEnabled;
+        } Settings;
         void updateFPS(int);
+        void updateStatistics(qint64 timestamp, bool isFrameProcessed);
         void resetROI();
+        cv::Rect getFrameROI(const cv::Size &frameSize);
+        void updateAdaptiveQuality(qint64 waitTime, qint64 workTime);
+        bool convertRawFrame(const cv::Mat &frame, bool toGrayscale, cv::Mat &convertedFrame);
+        cv::Mat getScratchFrame(int type);
+        template<bool grayscaleOn, bool smoothOn, bool dilateOn, bool erodeOn, bool flipOn, bool cannyOn>
+        void runPipeline();
+        static Pipeline getPipeline(const ImageProcessingFlags &imgProcFlags);
+        void publishSettings();
+        void applySettings();
+        bool beginOptionalStage(int stage);
+        void endOptionalStage(int stage);
+        void markStageTime(int stage);
         SharedImageBuffer *m_sharedImageBuffer;
+        StreamMetrics *m_metrics;
         cv::Mat m_currentFrame;
+        ScratchArena m_scratchArena;
         cv::Mat m_currentFrameGrayscale;
-        cv::Rect m_currentROI;
+        cv::Rect m_currentROI; // In input source coordinates
+        cv::Size m_inputSourceSize;
         QImage m_frame;
         QTime m_t;
+        QElapsedTimer m_waitTimer;
+        QElapsedTimer m_workTimer;
+        QElapsedTimer m_stageTimer;
+        QHash<int, double> m_stageTimeMap; // Estimated time (ms) of each optional stage
         QQueue<int> m_fps;
         QMutex m_doStopMutex;
-        QMutex m_processingMutex;
+        QMutex m_settingsMutex;
+        Settings m_pendingSettings;
+        TripleBuffer<Settings> m_settingsBuffer;
+        QMutex m_lastProcessedFrameMutex;
+        cv::Mat m_lastProcessedFrame;
         cv::Size m_frameSize;
         cv::Point m_framePoint;
         ImageProcessingFlags m_imgProcFlags;
         ImageProcessingSettings m_imgProcSettings;
+        Pipeline m_pipeline;
         ThreadStatisticsData m_statsData;
+        StatsRing<PerformanceSample> m_performanceRing;
+        PerformanceSample m_performanceSample;
+        qint64 m_stageTimeMark; // Work timer (ns) at end of previous stage
+        AdaptiveQualityController m_adaptiveQualityController;
+        QMutex m_adaptiveQualityMutex;
+        bool m_adaptiveQualityEnabled;
+        int m_nFramesSkipped;
+        int m_processingDeadline;
+        int m_maxFrameAge;
+        int m_rawFormat; // FOURCC of frames in image buffer (0: BGR)
+        cv::Size m_decodedFrameSize;
+        ThreadSchedulingData m_schedulingData;
+        qint64 m_deadline;
+        bool m_isCurrentFrameDegraded;
         volatile bool m_doStop;
         int m_processingTime;
         int m_fpsSum;
@@ -87,7 +156,9 @@ class ProcessingThread : public QThread
 
     signals:
         void newFrame(const QImage& frame);
+        void newProcessedFrame(int deviceNumber, const cv::Mat& frame);
         void updateStatisticsInGUI(ThreadStatisticsData statData);
+        void qualityLevelChanged(QualityLevelChangeData event);
 };
 
 #endif // PROCESSINGTHREAD_H
@@ -0,0 +1,87 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ScratchArena.cpp                                                     */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "ScratchArena.h"
+
+ScratchArena::ScratchArena(int maxMats)
+{
+    m_maxMats = maxMats;
+    m_nAllocations = 0;
+}
+
+cv::Mat ScratchArena::get(cv::Size size, int type)
+{
+    // Reuse Mat of same size and type which is only referenced by the arena
+    for (int i = 0; i < m_mats.size(); i++)
+    {
+        const cv::Mat &mat = m_mats.at(i);
+        if ((mat.size() == size) && (mat.type() == type) && !isReferenced(mat))
+        {
+            m_mats.move(i, 0);
+            return m_mats.first();
+        }
+    }
+    // Allocate new Mat (evicting least recently used Mat which is not referenced, if arena is full)
+    cv::Mat mat(size, type);
+    m_nAllocations++;
+    if (m_mats.size() >= m_maxMats)
+    {
+        for (int i = m_mats.size() - 1; i >= 0; i--)
+        {
+            if (!isReferenced(m_mats.at(i)))
+            {
+                m_mats.removeAt(i);
+                break;
+            }
+        }
+    }
+    // Arena is full of referenced Mats: Mat is not kept
+    if (m_mats.size() < m_maxMats)
+    {
+        m_mats.prepend(mat);
+    }
+    return mat;
+}
+
+int ScratchArena::takeAllocationCount()
+{
+    // Number of allocations since last call
+    int nAllocations = m_nAllocations;
+    m_nAllocations = 0;
+    return nAllocations;
+}
+
+bool ScratchArena::isReferenced(const cv::Mat &mat)
+{
+    // Reference held by arena itself is not counted
+    return (mat.u != 0) && (mat.u->refcount > 1);
+}
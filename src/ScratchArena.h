@@ -0,0 +1,58 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ScratchArena.h                                                       */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef SCRATCHARENA_H
+#define SCRATCHARENA_H
+
+#include <QList>
+
+#include <opencv2/opencv.hpp>
+
+// Preallocated images for processing stages (one arena per processing thread). Stages render into a Mat from the
+// arena instead of allocating a new destination every frame; a Mat is only handed out again once no other Mat
+// header (e.g. the previous stage's output, a frame held by an output) references its data, so consecutive stages
+// alternate between Mats of the same size and type (ping-pong). In steady state no memory is allocated.
+class ScratchArena
+{
+    public:
+        ScratchArena(int maxMats);
+        cv::Mat get(cv::Size size, int type);
+        int takeAllocationCount();
+
+    private:
+        static bool isReferenced(const cv::Mat &mat);
+        QList<cv::Mat> m_mats; // Most recently used first
+        int m_maxMats;
+        int m_nAllocations;
+};
+
+#endif // SCRATCHARENA_H
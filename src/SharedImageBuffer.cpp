@@ -32,13 +32,17 @@
 
 #include "SharedImageBuffer.h"
 
-SharedImageBuffer::SharedImageBuffer()
+#include "SharedMemoryFrameBus.h"
+#include "Config.h"
+
+SharedImageBuffer::SharedImageBuffer() :
+    m_frameMemoryBudget((qint64)DEFAULT_FRAME_MEMORY_BUDGET_MB * 1024 * 1024)
 {
     m_nArrived = 0;
     m_doSync = false;
 }
 
-void SharedImageBuffer::add(int deviceNumber, Buffer<cv::Mat>* imageBuffer, bool sync)
+void SharedImageBuffer::add(int deviceNumber, Buffer<cv::Mat>* imageBuffer, bool sync, bool publish)
 {
     // Device stream is to be synchronized
     if(sync)
@@ -47,6 +51,13 @@ void SharedImageBuffer::add(int deviceNumber, Buffer<cv::Mat>* imageBuffer, bool
         m_syncSet.insert(deviceNumber);
         m_mutex.unlock();
     }
+    // Device stream is to be published to shared memory (segment is created when the first frame arrives)
+    if(publish)
+    {
+        QMutexLocker locker(&m_frameWriterMutex);
+        m_frameWriterMap[deviceNumber] = new SharedMemoryFrameWriter(QString(SHARED_MEMORY_FRAME_BUS_NAME_PREFIX) + QString::number(deviceNumber),
+                                                                     SHARED_MEMORY_FRAME_BUS_SLOT_COUNT);
+    }
     // Add image buffer to map
     m_imageBufferMap[deviceNumber] = imageBuffer;
 }
@@ -61,6 +72,17 @@ void SharedImageBuffer::removeByDeviceNumber(int deviceNumber)
     // Remove buffer for device from imageBufferMap
     m_imageBufferMap.remove(deviceNumber);
 
+    // Remove shared memory frame writer (if present): waits for a publish in progress
+    m_frameWriterMutex.lock();
+    if (m_frameWriterMap.contains(deviceNumber))
+    {
+        delete m_frameWriterMap.take(deviceNumber);
+    }
+    m_frameWriterMutex.unlock();
+
+    // Remove from frame memory budget (part of the budget is redistributed to the remaining streams)
+    m_frameMemoryBudget.removeStream(deviceNumber);
+
     // Also remove from syncSet (if present)
     m_mutex.lock();
     if (m_syncSet.contains(deviceNumber))
@@ -120,3 +142,25 @@ bool SharedImageBuffer::containsImageBufferForDeviceNumber(int deviceNumber)
 {
     return m_imageBufferMap.contains(deviceNumber);
 }
+
+void SharedImageBuffer::publish(int deviceNumber, const cv::Mat &frame, int fourcc)
+{
+    // Only publish if enabled for specified device/stream (map is modified by the GUI thread)
+    QMutexLocker locker(&m_frameWriterMutex);
+    SharedMemoryFrameWriter *frameWriter = m_frameWriterMap.value(deviceNumber, 0);
+    if (frameWriter != 0)
+    {
+        frameWriter->publish(frame, (quint32)fourcc);
+    }
+}
+
+bool SharedImageBuffer::isPublishEnabledForDeviceNumber(int deviceNumber)
+{
+    QMutexLocker locker(&m_frameWriterMutex);
+    return m_frameWriterMap.contains(deviceNumber);
+}
+
+FrameMemoryBudget* SharedImageBuffer::getFrameMemoryBudget()
+{
+    return &m_frameMemoryBudget;
+}
@@ -41,12 +41,15 @@
 #include <opencv2/opencv.hpp>
 
 #include "Buffer.h"
+#include "FrameMemoryBudget.h"
+
+class SharedMemoryFrameWriter;
 
 class SharedImageBuffer
 {
     public:
         SharedImageBuffer();
-        void add(int deviceNumber, Buffer<cv::Mat> *imageBuffer, bool sync = false);
+        void add(int deviceNumber, Buffer<cv::Mat> *imageBuffer, bool sync = false, bool publish = false);
         Buffer<cv::Mat>* getByDeviceNumber(int deviceNumber);
         void removeByDeviceNumber(int deviceNumber);
         void sync(int deviceNumber);
@@ -55,12 +58,18 @@ class SharedImageBuffer
         bool isSyncEnabledForDeviceNumber(int deviceNumber);
         bool getSyncEnabled();
         bool containsImageBufferForDeviceNumber(int deviceNumber);
+        void publish(int deviceNumber, const cv::Mat &frame, int fourcc = 0);
+        bool isPublishEnabledForDeviceNumber(int deviceNumber);
+        FrameMemoryBudget* getFrameMemoryBudget();
 
     private:
         QHash<int, Buffer<cv::Mat>*> m_imageBufferMap;
+        QHash<int, SharedMemoryFrameWriter*> m_frameWriterMap;
+        FrameMemoryBudget m_frameMemoryBudget;
         QSet<int> m_syncSet;
         QWaitCondition m_wc;
         QMutex m_mutex;
+        QMutex m_frameWriterMutex;
         int m_nArrived;
         bool m_doSync;
 };
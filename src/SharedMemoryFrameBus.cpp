@@ -0,0 +1,406 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SharedMemoryFrameBus.cpp                                             */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SharedMemoryFrameBus.h"
+
+#include <QDebug>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+namespace {
+    // Round up to a multiple of the cache line size so that slot headers never share a line with pixel data of another slot
+    size_t alignToCacheLine(size_t size)
+    {
+        return (size + 63) & ~((size_t)63);
+    }
+
+    size_t busHeaderSize()
+    {
+        return alignToCacheLine(sizeof(SharedMemoryFrameBusHeader));
+    }
+
+    quint64 monotonicTimestampNs()
+    {
+#ifdef Q_OS_UNIX
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (quint64)ts.tv_sec * 1000000000ULL + (quint64)ts.tv_nsec;
+#else
+        return 0;
+#endif
+    }
+}
+
+SharedMemoryFrameWriter::SharedMemoryFrameWriter(const QString &name, int slotCount)
+{
+    m_name = name;
+    m_slotCount = slotCount > 0 ? slotCount : 1;
+    m_fd = -1;
+    m_memory = 0;
+    m_memorySize = 0;
+    m_header = 0;
+    m_sequenceNumber = 0;
+    m_creationFailed = false;
+}
+
+SharedMemoryFrameWriter::~SharedMemoryFrameWriter()
+{
+    close();
+}
+
+bool SharedMemoryFrameWriter::create(size_t slotDataSize)
+{
+#ifdef Q_OS_UNIX
+    QByteArray name = m_name.toLocal8Bit();
+    size_t slotHeaderSize = alignToCacheLine(sizeof(SharedMemoryFrameSlotHeader));
+    size_t slotStride = slotHeaderSize + alignToCacheLine(slotDataSize);
+    size_t memorySize = busHeaderSize() + slotStride * m_slotCount;
+
+    // Remove stale segment (e.g. left behind by a crashed instance)
+    shm_unlink(name.constData());
+    // Create segment
+    m_fd = shm_open(name.constData(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (m_fd == -1)
+    {
+        qDebug() << "WARNING: Could not create shared memory segment" << m_name << ":" << strerror(errno);
+        return false;
+    }
+    if (ftruncate(m_fd, memorySize) == -1)
+    {
+        qDebug() << "WARNING: Could not resize shared memory segment" << m_name << ":" << strerror(errno);
+        ::close(m_fd);
+        m_fd = -1;
+        shm_unlink(name.constData());
+        return false;
+    }
+    m_memory = mmap(0, memorySize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_memory == MAP_FAILED)
+    {
+        qDebug() << "WARNING: Could not map shared memory segment" << m_name << ":" << strerror(errno);
+        m_memory = 0;
+        ::close(m_fd);
+        m_fd = -1;
+        shm_unlink(name.constData());
+        return false;
+    }
+    m_memorySize = memorySize;
+
+    // Initialize header (ftruncate zero-fills the segment, so all slot seqlocks start at 0)
+    m_header = new (m_memory) SharedMemoryFrameBusHeader;
+    m_header->version = SHARED_MEMORY_FRAME_BUS_VERSION;
+    m_header->slotCount = m_slotCount;
+    m_header->slotHeaderSize = slotHeaderSize;
+    m_header->slotDataSize = slotStride - slotHeaderSize;
+    m_header->slotStride = slotStride;
+    m_header->latestSequenceNumber.store(0, std::memory_order_relaxed);
+    m_header->closed.store(0, std::memory_order_relaxed);
+    m_header->reserved = 0;
+    for (int i = 0; i < m_slotCount; i++)
+    {
+        new (slotHeader(i)) SharedMemoryFrameSlotHeader;
+        slotHeader(i)->seqlock.store(0, std::memory_order_relaxed);
+    }
+    // Readers check the magic number last: publish it only once the rest of the header is valid
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = SHARED_MEMORY_FRAME_BUS_MAGIC;
+
+    qDebug() << "Created shared memory frame bus" << m_name << "(" << m_slotCount << "slots of" << m_header->slotDataSize << "bytes )";
+    return true;
+#else
+    Q_UNUSED(slotDataSize);
+    qDebug() << "WARNING: Shared memory frame bus is not supported on this platform.";
+    return false;
+#endif
+}
+
+void SharedMemoryFrameWriter::close()
+{
+#ifdef Q_OS_UNIX
+    if (m_header != 0)
+    {
+        // Inform readers that this segment has been abandoned
+        m_header->closed.store(1, std::memory_order_release);
+        munmap(m_memory, m_memorySize);
+        ::close(m_fd);
+        shm_unlink(m_name.toLocal8Bit().constData());
+        m_header = 0;
+        m_memory = 0;
+        m_memorySize = 0;
+        m_fd = -1;
+    }
+#endif
+}
+
+bool SharedMemoryFrameWriter::publish(const cv::Mat &frame, quint32 fourcc)
+{
+    if (frame.empty())
+    {
+        return false;
+    }
+
+    size_t rowSize = frame.cols * frame.elemSize();
+    size_t frameSize = rowSize * frame.rows;
+
+    // Create segment on first frame (sized for that frame), re-create it if a larger frame arrives
+    if ((m_header == 0) || (frameSize > m_header->slotDataSize))
+    {
+        if (m_creationFailed)
+        {
+            return false;
+        }
+        close();
+        if (!create(frameSize))
+        {
+            // Do not retry on every frame
+            m_creationFailed = true;
+            return false;
+        }
+    }
+
+    // Select slot
+    m_sequenceNumber++;
+    int slot = (int)((m_sequenceNumber - 1) % m_slotCount);
+    SharedMemoryFrameSlotHeader *header = slotHeader(slot);
+    uchar *data = (uchar*)header + m_header->slotHeaderSize;
+
+    // Begin write (odd seqlock value)
+    quint32 seqlock = header->seqlock.load(std::memory_order_relaxed);
+    header->seqlock.store(seqlock + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    // Write frame
+    header->type = frame.type();
+    header->fourcc = fourcc;
+    header->rows = frame.rows;
+    header->cols = frame.cols;
+    header->step = rowSize;
+    header->sequenceNumber = m_sequenceNumber;
+    header->timestamp = monotonicTimestampNs();
+    header->size = frameSize;
+    if (frame.isContinuous())
+    {
+        memcpy(data, frame.data, frameSize);
+    }
+    else
+    {
+        for (int i = 0; i < frame.rows; i++)
+        {
+            memcpy(data + i * rowSize, frame.ptr(i), rowSize);
+        }
+    }
+
+    // End write (even seqlock value)
+    header->seqlock.store(seqlock + 2, std::memory_order_release);
+    m_header->latestSequenceNumber.store(m_sequenceNumber, std::memory_order_release);
+    return true;
+}
+
+QString SharedMemoryFrameWriter::getName() const
+{
+    return m_name;
+}
+
+quint64 SharedMemoryFrameWriter::getSequenceNumber() const
+{
+    return m_sequenceNumber;
+}
+
+SharedMemoryFrameSlotHeader* SharedMemoryFrameWriter::slotHeader(int slot)
+{
+    return (SharedMemoryFrameSlotHeader*)((uchar*)m_memory + busHeaderSize() + slot * m_header->slotStride);
+}
+
+SharedMemoryFrameReader::SharedMemoryFrameReader(const QString &name)
+{
+    m_name = name;
+    m_fd = -1;
+    m_memory = 0;
+    m_memorySize = 0;
+    m_header = 0;
+}
+
+SharedMemoryFrameReader::~SharedMemoryFrameReader()
+{
+    close();
+}
+
+bool SharedMemoryFrameReader::open()
+{
+#ifdef Q_OS_UNIX
+    close();
+    // Open segment
+    m_fd = shm_open(m_name.toLocal8Bit().constData(), O_RDONLY, 0);
+    if (m_fd == -1)
+    {
+        return false;
+    }
+    struct stat st;
+    if ((fstat(m_fd, &st) == -1) || ((size_t)st.st_size < busHeaderSize()))
+    {
+        close();
+        return false;
+    }
+    m_memory = mmap(0, st.st_size, PROT_READ, MAP_SHARED, m_fd, 0);
+    if (m_memory == MAP_FAILED)
+    {
+        m_memory = 0;
+        close();
+        return false;
+    }
+    m_memorySize = st.st_size;
+    m_header = (const SharedMemoryFrameBusHeader*)m_memory;
+
+    // Validate header (magic number is written last by the writer)
+    bool valid = (m_header->magic == SHARED_MEMORY_FRAME_BUS_MAGIC);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && (m_header->version == SHARED_MEMORY_FRAME_BUS_VERSION) && (m_header->slotCount > 0) &&
+            (busHeaderSize() + m_header->slotStride * m_header->slotCount <= m_memorySize);
+    if (!valid)
+    {
+        close();
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+void SharedMemoryFrameReader::close()
+{
+#ifdef Q_OS_UNIX
+    if (m_memory != 0)
+    {
+        munmap(m_memory, m_memorySize);
+    }
+    if (m_fd != -1)
+    {
+        ::close(m_fd);
+    }
+#endif
+    m_fd = -1;
+    m_memory = 0;
+    m_memorySize = 0;
+    m_header = 0;
+}
+
+bool SharedMemoryFrameReader::isOpen() const
+{
+    return m_header != 0;
+}
+
+bool SharedMemoryFrameReader::isWriterClosed() const
+{
+    return (m_header == 0) || (m_header->closed.load(std::memory_order_acquire) != 0);
+}
+
+quint64 SharedMemoryFrameReader::getLatestSequenceNumber() const
+{
+    return (m_header == 0) ? 0 : m_header->latestSequenceNumber.load(std::memory_order_acquire);
+}
+
+bool SharedMemoryFrameReader::getLatestFrame(cv::Mat &frame, SharedMemoryFrameInfo &info)
+{
+    quint64 sequenceNumber = getLatestSequenceNumber();
+    if (sequenceNumber == 0)
+    {
+        return false;
+    }
+    return getFrame(sequenceNumber, frame, info);
+}
+
+bool SharedMemoryFrameReader::getFrame(quint64 sequenceNumber, cv::Mat &frame, SharedMemoryFrameInfo &info)
+{
+    if ((m_header == 0) || (sequenceNumber == 0))
+    {
+        return false;
+    }
+
+    int slot = (int)((sequenceNumber - 1) % m_header->slotCount);
+    const SharedMemoryFrameSlotHeader *header = slotHeader(slot);
+
+    // Writer is currently updating this slot
+    quint32 seqlock = header->seqlock.load(std::memory_order_acquire);
+    if (seqlock & 1)
+    {
+        return false;
+    }
+    // Read slot header
+    quint64 slotSequenceNumber = header->sequenceNumber;
+    quint64 timestamp = header->timestamp;
+    int type = header->type;
+    quint32 fourcc = header->fourcc;
+    int rows = header->rows;
+    int cols = header->cols;
+    size_t step = header->step;
+    // Slot was overwritten while reading or holds another frame
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((header->seqlock.load(std::memory_order_relaxed) != seqlock) || (slotSequenceNumber != sequenceNumber))
+    {
+        return false;
+    }
+
+    // Wrap pixel data in shared memory (no copy); the frame must be treated as read-only
+    frame = cv::Mat(rows, cols, type, (uchar*)header + m_header->slotHeaderSize, step);
+    info.sequenceNumber = slotSequenceNumber;
+    info.timestamp = timestamp;
+    info.fourcc = fourcc;
+    info.slot = slot;
+    info.seqlock = seqlock;
+    return true;
+}
+
+bool SharedMemoryFrameReader::isFrameValid(const SharedMemoryFrameInfo &info) const
+{
+    if (m_header == 0)
+    {
+        return false;
+    }
+    // Frame data is only valid if the writer has not touched the slot since getFrame()
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slotHeader(info.slot)->seqlock.load(std::memory_order_relaxed) == info.seqlock;
+}
+
+const SharedMemoryFrameSlotHeader* SharedMemoryFrameReader::slotHeader(int slot) const
+{
+    return (const SharedMemoryFrameSlotHeader*)((const uchar*)m_memory + busHeaderSize() + slot * m_header->slotStride);
+}
@@ -0,0 +1,147 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SharedMemoryFrameBus.h                                               */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef SHAREDMEMORYFRAMEBUS_H
+#define SHAREDMEMORYFRAMEBUS_H
+
+#include <QString>
+
+#include <opencv2/opencv.hpp>
+
+#include <atomic>
+
+// Shared memory layout (native byte order):
+//   [SharedMemoryFrameBusHeader][slot 0][slot 1]...[slot slotCount-1]
+// Each slot is a SharedMemoryFrameSlotHeader followed by slotDataSize bytes of pixel data, and
+// consecutive slots are slotStride bytes apart. Frame N (1-based sequence number) is written to
+// slot (N-1) % slotCount.
+//
+// Each slot header is protected by a seqlock: the writer increments 'seqlock' to an odd value
+// before touching the slot and to the next even value when done. A reader records 'seqlock'
+// (retrying while it is odd), reads the slot, then re-reads 'seqlock': the data is valid only if
+// the two values are equal.
+//
+// If the writer has to resize the segment (larger frames) or shuts down, it sets 'closed' in the
+// bus header and unlinks the segment; readers should then reopen by name.
+
+#define SHARED_MEMORY_FRAME_BUS_MAGIC       0x51434642 // "QCFB"
+#define SHARED_MEMORY_FRAME_BUS_VERSION     2
+
+struct SharedMemoryFrameBusHeader
+{
+    quint32 magic;
+    quint32 version;
+    quint32 slotCount;
+    quint32 slotHeaderSize;
+    quint64 slotDataSize;
+    quint64 slotStride;
+    // Sequence number of the most recently completed frame (0 if none)
+    std::atomic<quint64> latestSequenceNumber;
+    // Non-zero once the writer has abandoned this segment
+    std::atomic<quint32> closed;
+    quint32 reserved;
+};
+
+struct SharedMemoryFrameSlotHeader
+{
+    std::atomic<quint32> seqlock;
+    // cv::Mat type (e.g. CV_8UC3)
+    qint32 type;
+    // FOURCC of raw frames (e.g. MJPG: compressed image in a single CV_8UC1 row, YUYV: CV_8UC2), 0 if pixel data is
+    // BGR or grayscale as given by type
+    quint32 fourcc;
+    qint32 rows;
+    qint32 cols;
+    quint64 step;
+    quint64 sequenceNumber;
+    // CLOCK_MONOTONIC time (nanoseconds) at which the frame was published
+    quint64 timestamp;
+    // Number of bytes of pixel data
+    quint64 size;
+};
+
+typedef struct
+{
+    quint64 sequenceNumber;
+    quint64 timestamp;
+    quint32 fourcc;
+    int slot;
+    quint32 seqlock;
+} SharedMemoryFrameInfo;
+
+class SharedMemoryFrameWriter
+{
+    public:
+        SharedMemoryFrameWriter(const QString &name, int slotCount);
+        ~SharedMemoryFrameWriter();
+        bool publish(const cv::Mat &frame, quint32 fourcc = 0);
+        void close();
+        QString getName() const;
+        quint64 getSequenceNumber() const;
+
+    private:
+        bool create(size_t slotDataSize);
+        SharedMemoryFrameSlotHeader* slotHeader(int slot);
+        QString m_name;
+        int m_slotCount;
+        int m_fd;
+        void *m_memory;
+        size_t m_memorySize;
+        SharedMemoryFrameBusHeader *m_header;
+        quint64 m_sequenceNumber;
+        bool m_creationFailed;
+};
+
+class SharedMemoryFrameReader
+{
+    public:
+        SharedMemoryFrameReader(const QString &name);
+        ~SharedMemoryFrameReader();
+        bool open();
+        void close();
+        bool isOpen() const;
+        bool isWriterClosed() const;
+        quint64 getLatestSequenceNumber() const;
+        bool getLatestFrame(cv::Mat &frame, SharedMemoryFrameInfo &info);
+        bool getFrame(quint64 sequenceNumber, cv::Mat &frame, SharedMemoryFrameInfo &info);
+        bool isFrameValid(const SharedMemoryFrameInfo &info) const;
+
+    private:
+        const SharedMemoryFrameSlotHeader* slotHeader(int slot) const;
+        QString m_name;
+        int m_fd;
+        void *m_memory;
+        size_t m_memorySize;
+        const SharedMemoryFrameBusHeader *m_header;
+};
+
+#endif // SHAREDMEMORYFRAMEBUS_H
@@ -0,0 +1,756 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SimdKernels.cpp                                                      */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SimdKernels.h"
+
+#include "Config.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QDebug>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+// x86 kernels are compiled for their instruction set with function attributes (the rest of the application keeps the
+// baseline) and only called after runtime detection
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_KERNELS_X86
+#include <immintrin.h>
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+    // Fixed-point coefficients of cv::cvtColor (BGR to grayscale)
+    const int GrayShift = 14;
+    const int GrayB = 1868;
+    const int GrayG = 9617;
+    const int GrayR = 4899;
+
+    // Index of pixel outside [0, length) with BORDER_REFLECT_101 (as cv::borderInterpolate)
+    int reflect101(int i, int length)
+    {
+        if (length == 1)
+        {
+            return 0;
+        }
+        while ((i < 0) || (i >= length))
+        {
+            i = (i < 0) ? -i : 2 * length - 2 - i;
+        }
+        return i;
+    }
+
+    // Scalar kernels (also used for the remainder of rows in the vectorized kernels)
+    void bgrToGrayRowScalar(const uchar *src, uchar *dst, int width)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const uchar *pixel = src + x * 3;
+            dst[x] = (uchar)((pixel[0] * GrayB + pixel[1] * GrayG + pixel[2] * GrayR + (1 << (GrayShift - 1))) >> GrayShift);
+        }
+    }
+
+    // Column sums of box blur: sums += add - sub (wraps around in intermediate steps, final sums fit in 16 bits)
+    void updateColumnSumsScalar(ushort *sums, const uchar *add, const uchar *sub, int n)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            sums[i] = (ushort)(sums[i] + add[i] - sub[i]);
+        }
+    }
+
+    // Column sums of column x outside the image (BORDER_REFLECT_101)
+    void reflectColumnSums(ushort *sums, int x, int width, int channels)
+    {
+        const ushort *source = sums + reflect101(x, width) * channels;
+        std::copy(source, source + channels, sums + x * channels);
+    }
+
+    // Sum of kernelWidth column sums (step apart), divided by kernel area and rounded (half up)
+    void sumColumnSumsScalar(const ushort *sums, uchar *dst, int n, int kernelWidth, int step, int area)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            int sum = 0;
+            for (int j = 0; j < kernelWidth; j++)
+            {
+                sum += sums[i + j * step];
+            }
+            dst[i] = (uchar)((2 * sum + area) / (2 * area));
+        }
+    }
+
+    // Pixels start..width-1 of row mirrored horizontally
+    void flipRowScalar(const uchar *src, uchar *dst, int width, int channels, int start)
+    {
+        for (int x = start; x < width; x++)
+        {
+            const uchar *srcPixel = src + (width - 1 - x) * channels;
+            uchar *dstPixel = dst + x * channels;
+            for (int c = 0; c < channels; c++)
+            {
+                dstPixel[c] = srcPixel[c];
+            }
+        }
+    }
+
+#ifdef SIMD_KERNELS_X86
+    // Byte shuffles gathering channel c of 16 BGR pixels from chunk k (16 bytes) of the 48 bytes (-128: zero)
+    const signed char GrayShuffle[3][3][16] = {
+        { { 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 1, 4, 7, 10, 13 } },
+        { { 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 2, 5, 8, 11, 14 } },
+        { { 2, 5, 8, 11, 14, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, 1, 4, 7, 10, 13, -128, -128, -128, -128, -128, -128 }, { -128, -128, -128, -128, -128, -128, -128, -128, -128, -128, 0, 3, 6, 9, 12, 15 } }
+    };
+    // Byte shuffle reversing the order of 16 pixels (1 channel)
+    const signed char FlipShuffle1[16] = { 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0 };
+    // Byte shuffle reversing the order of 5 BGR pixels (bytes 1..15 of the 16 bytes loaded)
+    const signed char FlipShuffle3[16] = { 13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, 1, 2, 3, -128 };
+
+    // SSE4.1: 16 pixels per iteration
+    TARGET_SSE41 __m128i grayFromPlanesSse41(__m128i b, __m128i g, __m128i r)
+    {
+        // Pairs (b,g) and (r,1) are multiplied by (GrayB,GrayG) and (GrayR,rounding) and summed (madd)
+        const __m128i bgCoefficients = _mm_set1_epi32((GrayG << 16) | GrayB);
+        const __m128i rCoefficients = _mm_set1_epi32(((1 << (GrayShift - 1)) << 16) | GrayR);
+        const __m128i ones = _mm_set1_epi16(1);
+        __m128i low = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(b, g), bgCoefficients), _mm_madd_epi16(_mm_unpacklo_epi16(r, ones), rCoefficients));
+        __m128i high = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(b, g), bgCoefficients), _mm_madd_epi16(_mm_unpackhi_epi16(r, ones), rCoefficients));
+        return _mm_packs_epi32(_mm_srli_epi32(low, GrayShift), _mm_srli_epi32(high, GrayShift));
+    }
+
+    TARGET_SSE41 void bgrToGrayRowSse41(const uchar *src, uchar *dst, int width)
+    {
+        __m128i shuffles[3][3];
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                shuffles[c][k] = _mm_loadu_si128((const __m128i*)GrayShuffle[c][k]);
+            }
+        }
+        const __m128i zero = _mm_setzero_si128();
+        int x = 0;
+        for (; x <= width - 16; x += 16)
+        {
+            const uchar *pixels = src + x * 3;
+            __m128i chunks[3];
+            for (int k = 0; k < 3; k++)
+            {
+                chunks[k] = _mm_loadu_si128((const __m128i*)(pixels + k * 16));
+            }
+            __m128i planes[3];
+            for (int c = 0; c < 3; c++)
+            {
+                planes[c] = _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(chunks[0], shuffles[c][0]), _mm_shuffle_epi8(chunks[1], shuffles[c][1])), _mm_shuffle_epi8(chunks[2], shuffles[c][2]));
+            }
+            __m128i low = grayFromPlanesSse41(_mm_unpacklo_epi8(planes[0], zero), _mm_unpacklo_epi8(planes[1], zero), _mm_unpacklo_epi8(planes[2], zero));
+            __m128i high = grayFromPlanesSse41(_mm_unpackhi_epi8(planes[0], zero), _mm_unpackhi_epi8(planes[1], zero), _mm_unpackhi_epi8(planes[2], zero));
+            _mm_storeu_si128((__m128i*)(dst + x), _mm_packus_epi16(low, high));
+        }
+        bgrToGrayRowScalar(src + x * 3, dst + x, width - x);
+    }
+
+    TARGET_SSE41 void updateColumnSumsSse41(ushort *sums, const uchar *add, const uchar *sub, int n)
+    {
+        int i = 0;
+        for (; i <= n - 8; i += 8)
+        {
+            __m128i added = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(add + i)));
+            __m128i subtracted = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*)(sub + i)));
+            __m128i columnSums = _mm_loadu_si128((const __m128i*)(sums + i));
+            _mm_storeu_si128((__m128i*)(sums + i), _mm_sub_epi16(_mm_add_epi16(columnSums, added), subtracted));
+        }
+        updateColumnSumsScalar(sums + i, add + i, sub + i, n - i);
+    }
+
+    // Division: (2*sum+area+0.5)/(2*area) in float is at least 1/(4*area) away from the next integer, so truncation
+    // gives the exact integer result
+    TARGET_SSE41 __m128i divideSse41(__m128i sums, __m128i area, __m128 scale)
+    {
+        const __m128 half = _mm_set1_ps(0.5f);
+        __m128 numerator = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_add_epi32(sums, sums), area)), half);
+        return _mm_cvttps_epi32(_mm_mul_ps(numerator, scale));
+    }
+
+    TARGET_SSE41 void sumColumnSumsSse41(const ushort *sums, uchar *dst, int n, int kernelWidth, int step, int area)
+    {
+        const __m128i areaVector = _mm_set1_epi32(area);
+        const __m128 scale = _mm_set1_ps(1.0f / (2 * area));
+        int i = 0;
+        for (; i <= n - 8; i += 8)
+        {
+            __m128i sum = _mm_loadu_si128((const __m128i*)(sums + i));
+            for (int j = 1; j < kernelWidth; j++)
+            {
+                sum = _mm_add_epi16(sum, _mm_loadu_si128((const __m128i*)(sums + i + j * step)));
+            }
+            __m128i low = divideSse41(_mm_cvtepu16_epi32(sum), areaVector, scale);
+            __m128i high = divideSse41(_mm_cvtepu16_epi32(_mm_srli_si128(sum, 8)), areaVector, scale);
+            __m128i result = _mm_packus_epi32(low, high);
+            _mm_storel_epi64((__m128i*)(dst + i), _mm_packus_epi16(result, result));
+        }
+        sumColumnSumsScalar(sums + i, dst + i, n - i, kernelWidth, step, area);
+    }
+
+    TARGET_SSE41 void flipRowSse41(const uchar *src, uchar *dst, int width, int channels)
+    {
+        int x = 0;
+        if (channels == 1)
+        {
+            const __m128i shuffle = _mm_loadu_si128((const __m128i*)FlipShuffle1);
+            for (; x + 16 <= width; x += 16)
+            {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(src + width - x - 16));
+                _mm_storeu_si128((__m128i*)(dst + x), _mm_shuffle_epi8(pixels, shuffle));
+            }
+        }
+        else if (channels == 3)
+        {
+            // 5 pixels per iteration: the 16th byte stored is overwritten by the next iteration (or the scalar remainder)
+            const __m128i shuffle = _mm_loadu_si128((const __m128i*)FlipShuffle3);
+            for (; x + 6 <= width; x += 5)
+            {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(src + (width - x - 5) * 3 - 1));
+                _mm_storeu_si128((__m128i*)(dst + x * 3), _mm_shuffle_epi8(pixels, shuffle));
+            }
+        }
+        else if (channels == 4)
+        {
+            for (; x + 4 <= width; x += 4)
+            {
+                __m128i pixels = _mm_loadu_si128((const __m128i*)(src + (width - x - 4) * 4));
+                _mm_storeu_si128((__m128i*)(dst + x * 4), _mm_shuffle_epi32(pixels, 0x1B));
+            }
+        }
+        flipRowScalar(src, dst, width, channels, x);
+    }
+
+    // AVX2: same algorithms, the two 128-bit lanes process independent halves (shuffles do not cross lanes)
+    TARGET_AVX2 __m256i grayFromPlanesAvx2(__m256i b, __m256i g, __m256i r)
+    {
+        const __m256i bgCoefficients = _mm256_set1_epi32((GrayG << 16) | GrayB);
+        const __m256i rCoefficients = _mm256_set1_epi32(((1 << (GrayShift - 1)) << 16) | GrayR);
+        const __m256i ones = _mm256_set1_epi16(1);
+        __m256i low = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(b, g), bgCoefficients), _mm256_madd_epi16(_mm256_unpacklo_epi16(r, ones), rCoefficients));
+        __m256i high = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(b, g), bgCoefficients), _mm256_madd_epi16(_mm256_unpackhi_epi16(r, ones), rCoefficients));
+        return _mm256_packs_epi32(_mm256_srli_epi32(low, GrayShift), _mm256_srli_epi32(high, GrayShift));
+    }
+
+    TARGET_AVX2 void bgrToGrayRowAvx2(const uchar *src, uchar *dst, int width)
+    {
+        __m256i shuffles[3][3];
+        for (int c = 0; c < 3; c++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                shuffles[c][k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)GrayShuffle[c][k]));
+            }
+        }
+        const __m256i zero = _mm256_setzero_si256();
+        int x = 0;
+        for (; x <= width - 32; x += 32)
+        {
+            // Lane 0: pixels 0..15, lane 1: pixels 16..31
+            const uchar *pixels = src + x * 3;
+            __m256i chunks[3];
+            for (int k = 0; k < 3; k++)
+            {
+                chunks[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)(pixels + k * 16))),
+                    _mm_loadu_si128((const __m128i*)(pixels + 48 + k * 16)), 1);
+            }
+            __m256i planes[3];
+            for (int c = 0; c < 3; c++)
+            {
+                planes[c] = _mm256_or_si256(_mm256_or_si256(_mm256_shuffle_epi8(chunks[0], shuffles[c][0]), _mm256_shuffle_epi8(chunks[1], shuffles[c][1])), _mm256_shuffle_epi8(chunks[2], shuffles[c][2]));
+            }
+            __m256i low = grayFromPlanesAvx2(_mm256_unpacklo_epi8(planes[0], zero), _mm256_unpacklo_epi8(planes[1], zero), _mm256_unpacklo_epi8(planes[2], zero));
+            __m256i high = grayFromPlanesAvx2(_mm256_unpackhi_epi8(planes[0], zero), _mm256_unpackhi_epi8(planes[1], zero), _mm256_unpackhi_epi8(planes[2], zero));
+            _mm256_storeu_si256((__m256i*)(dst + x), _mm256_packus_epi16(low, high));
+        }
+        bgrToGrayRowScalar(src + x * 3, dst + x, width - x);
+    }
+
+    TARGET_AVX2 void updateColumnSumsAvx2(ushort *sums, const uchar *add, const uchar *sub, int n)
+    {
+        int i = 0;
+        for (; i <= n - 16; i += 16)
+        {
+            __m256i added = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(add + i)));
+            __m256i subtracted = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(sub + i)));
+            __m256i columnSums = _mm256_loadu_si256((const __m256i*)(sums + i));
+            _mm256_storeu_si256((__m256i*)(sums + i), _mm256_sub_epi16(_mm256_add_epi16(columnSums, added), subtracted));
+        }
+        updateColumnSumsScalar(sums + i, add + i, sub + i, n - i);
+    }
+
+    TARGET_AVX2 __m256i divideAvx2(__m256i sums, __m256i area, __m256 scale)
+    {
+        const __m256 half = _mm256_set1_ps(0.5f);
+        __m256 numerator = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(sums, sums), area)), half);
+        return _mm256_cvttps_epi32(_mm256_mul_ps(numerator, scale));
+    }
+
+    TARGET_AVX2 void sumColumnSumsAvx2(const ushort *sums, uchar *dst, int n, int kernelWidth, int step, int area)
+    {
+        const __m256i areaVector = _mm256_set1_epi32(area);
+        const __m256 scale = _mm256_set1_ps(1.0f / (2 * area));
+        int i = 0;
+        for (; i <= n - 16; i += 16)
+        {
+            __m256i sum = _mm256_loadu_si256((const __m256i*)(sums + i));
+            for (int j = 1; j < kernelWidth; j++)
+            {
+                sum = _mm256_add_epi16(sum, _mm256_loadu_si256((const __m256i*)(sums + i + j * step)));
+            }
+            __m256i low = divideAvx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(sum)), areaVector, scale);
+            __m256i high = divideAvx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(sum, 1)), areaVector, scale);
+            // Packing works per lane: restore element order after each step
+            __m256i result = _mm256_permute4x64_epi64(_mm256_packus_epi32(low, high), 0xD8);
+            result = _mm256_permute4x64_epi64(_mm256_packus_epi16(result, result), 0x08);
+            _mm_storeu_si128((__m128i*)(dst + i), _mm256_castsi256_si128(result));
+        }
+        sumColumnSumsScalar(sums + i, dst + i, n - i, kernelWidth, step, area);
+    }
+
+    TARGET_AVX2 void flipRowAvx2(const uchar *src, uchar *dst, int width, int channels)
+    {
+        int x = 0;
+        if (channels == 1)
+        {
+            const __m256i shuffle = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)FlipShuffle1));
+            for (; x + 32 <= width; x += 32)
+            {
+                // Reverse bytes within lanes, then swap lanes
+                __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + width - x - 32));
+                _mm256_storeu_si256((__m256i*)(dst + x), _mm256_permute4x64_epi64(_mm256_shuffle_epi8(pixels, shuffle), 0x4E));
+            }
+        }
+        else if (channels == 3)
+        {
+            // 3-byte pixels cannot be reversed across lanes with a single shuffle
+            flipRowSse41(src, dst, width, channels);
+            return;
+        }
+        else if (channels == 4)
+        {
+            const __m256i permutation = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+            for (; x + 8 <= width; x += 8)
+            {
+                __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + (width - x - 8) * 4));
+                _mm256_storeu_si256((__m256i*)(dst + x * 4), _mm256_permutevar8x32_epi32(pixels, permutation));
+            }
+        }
+        flipRowScalar(src, dst, width, channels, x);
+    }
+#endif
+
+    void bgrToGrayRow(const uchar *src, uchar *dst, int width, int level)
+    {
+#ifdef SIMD_KERNELS_X86
+        if (level >= SimdAvx2)
+        {
+            bgrToGrayRowAvx2(src, dst, width);
+            return;
+        }
+        if (level >= SimdSse41)
+        {
+            bgrToGrayRowSse41(src, dst, width);
+            return;
+        }
+#endif
+        bgrToGrayRowScalar(src, dst, width);
+    }
+
+    void updateColumnSums(ushort *sums, const uchar *add, const uchar *sub, int n, int level)
+    {
+#ifdef SIMD_KERNELS_X86
+        if (level >= SimdAvx2)
+        {
+            updateColumnSumsAvx2(sums, add, sub, n);
+            return;
+        }
+        if (level >= SimdSse41)
+        {
+            updateColumnSumsSse41(sums, add, sub, n);
+            return;
+        }
+#endif
+        updateColumnSumsScalar(sums, add, sub, n);
+    }
+
+    void sumColumnSums(const ushort *sums, uchar *dst, int n, int kernelWidth, int step, int area, int level)
+    {
+#ifdef SIMD_KERNELS_X86
+        if (level >= SimdAvx2)
+        {
+            sumColumnSumsAvx2(sums, dst, n, kernelWidth, step, area);
+            return;
+        }
+        if (level >= SimdSse41)
+        {
+            sumColumnSumsSse41(sums, dst, n, kernelWidth, step, area);
+            return;
+        }
+#endif
+        sumColumnSumsScalar(sums, dst, n, kernelWidth, step, area);
+    }
+
+    void flipRow(const uchar *src, uchar *dst, int width, int channels, int level)
+    {
+#ifdef SIMD_KERNELS_X86
+        if (level >= SimdAvx2)
+        {
+            flipRowAvx2(src, dst, width, channels);
+            return;
+        }
+        if (level >= SimdSse41)
+        {
+            flipRowSse41(src, dst, width, channels);
+            return;
+        }
+#endif
+        flipRowScalar(src, dst, width, channels, 0);
+    }
+
+    // Calibration: kernels must reproduce OpenCV exactly (on images with odd sizes to cover row remainders and
+    // borders) and are timed against OpenCV on VGA frames (color and grayscale, typical kernel sizes)
+    cv::Mat makeTestImage(cv::Size size, int type)
+    {
+        cv::Mat image(size, type);
+        cv::RNG rng(0x5EED);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        return image;
+    }
+
+    bool isEqual(const cv::Mat &a, const cv::Mat &b)
+    {
+        return (a.size() == b.size()) && (a.type() == b.type()) && (cv::norm(a, b, cv::NORM_INF) == 0);
+    }
+
+    bool validateBgrToGray(int level)
+    {
+        const cv::Size sizes[] = { cv::Size(1, 1), cv::Size(47, 5), cv::Size(643, 7) };
+        for (const cv::Size &size : sizes)
+        {
+            cv::Mat src = makeTestImage(size, CV_8UC3);
+            cv::Mat dst, reference;
+            cv::cvtColor(src, reference, CV_BGR2GRAY);
+            if (!simdBgrToGray(src, dst, level) || !isEqual(dst, reference))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool validateBoxBlurSize(cv::Size kernelSize, int type, int level)
+    {
+        // Image larger than kernel (and of odd size): covers borders, interior and row remainders
+        cv::Mat src = makeTestImage(cv::Size(std::max(67, 2 * kernelSize.width + 1), std::max(41, 2 * kernelSize.height + 1)), type);
+        cv::Mat dst, reference;
+        cv::blur(src, reference, kernelSize);
+        return simdBoxBlur(src, dst, kernelSize, level) && isEqual(dst, reference);
+    }
+
+    bool validateBoxBlur(int level)
+    {
+        // Kernel works at this level (kernel sizes are validated again on first use, see isSimdBoxBlurExact())
+        const cv::Size kernelSizes[] = { cv::Size(3, 3), cv::Size(5, 5), cv::Size(1, 7), cv::Size(15, 3) };
+        const int types[] = { CV_8UC1, CV_8UC3 };
+        for (const cv::Size &kernelSize : kernelSizes)
+        {
+            for (int type : types)
+            {
+                if (!validateBoxBlurSize(kernelSize, type, level))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    bool validateFlip(int level)
+    {
+        const int widths[] = { 1, 7, 67, 161 };
+        const int types[] = { CV_8UC1, CV_8UC3, CV_8UC4 };
+        const int flipCodes[] = { 1, -1 };
+        for (int width : widths)
+        {
+            for (int type : types)
+            {
+                for (int flipCode : flipCodes)
+                {
+                    cv::Mat src = makeTestImage(cv::Size(width, 5), type);
+                    cv::Mat dst, reference;
+                    cv::flip(src, reference, flipCode);
+                    if (!simdFlip(src, dst, flipCode, level) || !isEqual(dst, reference))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    // Best time (ns) of the calibration runs
+    template<typename Function>
+    qint64 measure(Function function)
+    {
+        QElapsedTimer timer;
+        qint64 bestTime = std::numeric_limits<qint64>::max();
+        for (int i = 0; i < SIMD_KERNELS_CALIBRATION_RUNS; i++)
+        {
+            timer.start();
+            function();
+            bestTime = std::min(bestTime, timer.nsecsElapsed());
+        }
+        return bestTime;
+    }
+
+    template<typename Validate, typename RunKernel, typename RunOpenCv>
+    int selectKernel(const char *name, Validate validate, RunKernel runKernel, RunOpenCv runOpenCv)
+    {
+        // Highest supported level which reproduces OpenCV
+        int level = getSupportedSimdLevel();
+        while ((level >= SimdScalar) && !validate(level))
+        {
+            qDebug() << "WARNING: Kernel" << name << "(" << getSimdLevelName(level) << ") does not match OpenCV and is not used.";
+            level--;
+        }
+        if ((level < SimdScalar) || (SIMD_KERNELS_MODE == 2))
+        {
+            return level;
+        }
+        // Used only if faster than OpenCV
+        qint64 kernelTime = measure([&]() { runKernel(level); });
+        qint64 openCvTime = measure(runOpenCv);
+        qDebug() << "Kernel" << name << "(" << getSimdLevelName(level) << "):" << kernelTime / 1000 << "us, OpenCV:" << openCvTime / 1000 << "us";
+        return (kernelTime < openCvTime) ? level : -1;
+    }
+
+    SimdKernelSelection selectSimdKernels()
+    {
+        SimdKernelSelection selection;
+        selection.bgrToGray = -1;
+        selection.boxBlur = -1;
+        selection.flip = -1;
+        if (SIMD_KERNELS_MODE == 0)
+        {
+            return selection;
+        }
+        cv::Mat frame = makeTestImage(cv::Size(640, 480), CV_8UC3);
+        cv::Mat grayFrame = makeTestImage(cv::Size(640, 480), CV_8UC1);
+        const cv::Size blurSizes[] = { cv::Size(3, 3), cv::Size(5, 5), cv::Size(9, 9), cv::Size(15, 15) };
+        cv::Mat result;
+        selection.bgrToGray = selectKernel("bgrToGray", validateBgrToGray,
+            [&](int level) { simdBgrToGray(frame, result, level); },
+            [&]() { cv::cvtColor(frame, result, CV_BGR2GRAY); });
+        selection.boxBlur = selectKernel("boxBlur", validateBoxBlur,
+            [&](int level)
+            {
+                for (const cv::Size &blurSize : blurSizes)
+                {
+                    simdBoxBlur(frame, result, blurSize, level);
+                    simdBoxBlur(grayFrame, result, blurSize, level);
+                }
+            },
+            [&]()
+            {
+                for (const cv::Size &blurSize : blurSizes)
+                {
+                    cv::blur(frame, result, blurSize);
+                    cv::blur(grayFrame, result, blurSize);
+                }
+            });
+        selection.flip = selectKernel("flip", validateFlip,
+            [&](int level)
+            {
+                simdFlip(frame, result, 1, level);
+                simdFlip(grayFrame, result, 1, level);
+            },
+            [&]()
+            {
+                cv::flip(frame, result, 1);
+                cv::flip(grayFrame, result, 1);
+            });
+        return selection;
+    }
+}
+
+int getSupportedSimdLevel()
+{
+#ifdef SIMD_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdAvx2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return SimdSse41;
+    }
+#endif
+    return SimdScalar;
+}
+
+const char *getSimdLevelName(int level)
+{
+    switch (level)
+    {
+        case SimdScalar:
+            return "scalar";
+        case SimdSse41:
+            return "SSE4.1";
+        case SimdAvx2:
+            return "AVX2";
+        default:
+            return "OpenCV";
+    }
+}
+
+const SimdKernelSelection &getSimdKernelSelection()
+{
+    // Selected once (initialization of local static is thread-safe)
+    static const SimdKernelSelection selection = selectSimdKernels();
+    return selection;
+}
+
+bool simdBgrToGray(const cv::Mat &src, cv::Mat &dst, int level)
+{
+    if ((src.type() != CV_8UC3) || src.empty())
+    {
+        return false;
+    }
+    // Keep source data (dst may refer to the same Mat)
+    cv::Mat source = src;
+    dst.create(source.size(), CV_8UC1);
+    for (int y = 0; y < source.rows; y++)
+    {
+        bgrToGrayRow(source.ptr<uchar>(y), dst.ptr<uchar>(y), source.cols, level);
+    }
+    return true;
+}
+
+bool simdBoxBlur(const cv::Mat &src, cv::Mat &dst, cv::Size ksize, int level)
+{
+    // Sums of up to 256 pixels fit in 16 bits
+    if ((src.depth() != CV_8U) || src.empty() || (ksize.width < 1) || (ksize.height < 1) || (ksize.area() > 256) || (dst.data == src.data))
+    {
+        return false;
+    }
+    int channels = src.channels();
+    int rowLength = src.cols * channels;
+    int anchorX = ksize.width / 2;
+    int anchorY = ksize.height / 2;
+    int paddedWidth = src.cols + ksize.width - 1;
+    // Column sums over the kernel height (padded with columns outside the image), kept between calls
+    static thread_local std::vector<ushort> sums;
+    static thread_local std::vector<uchar> zeros;
+    sums.assign((size_t)paddedWidth * channels, 0);
+    zeros.assign(rowLength, 0);
+    ushort *imageSums = &sums[(size_t)anchorX * channels];
+    dst.create(src.size(), src.type());
+    for (int i = 0; i < ksize.height; i++)
+    {
+        updateColumnSums(imageSums, src.ptr<uchar>(reflect101(i - anchorY, src.rows)), &zeros[0], rowLength, level);
+    }
+    for (int y = 0; y < src.rows; y++)
+    {
+        // Move column sums down one row
+        if (y > 0)
+        {
+            updateColumnSums(imageSums,
+                src.ptr<uchar>(reflect101(y - anchorY + ksize.height - 1, src.rows)),
+                src.ptr<uchar>(reflect101(y - anchorY - 1, src.rows)),
+                rowLength,
+                level);
+        }
+        // Columns outside the image
+        for (int x = -anchorX; x < 0; x++)
+        {
+            reflectColumnSums(imageSums, x, src.cols, channels);
+        }
+        for (int x = src.cols; x < paddedWidth - anchorX; x++)
+        {
+            reflectColumnSums(imageSums, x, src.cols, channels);
+        }
+        sumColumnSums(&sums[0], dst.ptr<uchar>(y), rowLength, ksize.width, channels, ksize.area(), level);
+    }
+    return true;
+}
+
+bool isSimdBoxBlurExact(cv::Size ksize, int channels, int level)
+{
+    // Sizes not handled by the kernel
+    if ((ksize.width < 1) || (ksize.height < 1) || (ksize.area() > 256) || (channels < 1) || (channels > CV_CN_MAX))
+    {
+        return false;
+    }
+    // Results of validation (key: level, channels, kernel width and height)
+    static thread_local QHash<quint64, bool> validatedMap;
+    quint64 key = ((quint64)level << 48) | ((quint64)channels << 32) | ((quint64)ksize.width << 16) | (quint64)ksize.height;
+    QHash<quint64, bool>::const_iterator it = validatedMap.constFind(key);
+    if (it != validatedMap.constEnd())
+    {
+        return it.value();
+    }
+    bool isExact = validateBoxBlurSize(ksize, CV_MAKETYPE(CV_8U, channels), level);
+    if (!isExact)
+    {
+        qDebug() << "Kernel boxBlur (" << getSimdLevelName(level) << ") does not match OpenCV for" << ksize.width << "x" << ksize.height
+                 << "kernel," << channels << "channel(s): OpenCV is used.";
+    }
+    validatedMap.insert(key, isExact);
+    return isExact;
+}
+
+bool simdFlip(const cv::Mat &src, cv::Mat &dst, int flipCode, int level)
+{
+    int channels = src.channels();
+    if ((src.depth() != CV_8U) || src.empty() || (flipCode == 0) || ((channels != 1) && (channels != 3) && (channels != 4)) || (dst.data == src.data))
+    {
+        return false;
+    }
+    dst.create(src.size(), src.type());
+    for (int y = 0; y < src.rows; y++)
+    {
+        // Flip around both axes: rows in reverse order
+        const uchar *srcRow = src.ptr<uchar>((flipCode < 0) ? src.rows - 1 - y : y);
+        flipRow(srcRow, dst.ptr<uchar>(y), src.cols, channels, level);
+    }
+    return true;
+}
@@ -0,0 +1,72 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SimdKernels.h                                                        */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+#include <opencv2/opencv.hpp>
+
+// Instruction sets of the hand-vectorized kernels (detected at runtime: OpenCV may be built for an older baseline)
+enum SimdLevel
+{
+    SimdScalar = 0,
+    SimdSse41 = 1,
+    SimdAvx2 = 2
+};
+
+// Level used for each kernel (-1: OpenCV is used)
+typedef struct
+{
+    int bgrToGray;
+    int boxBlur;
+    int flip;
+} SimdKernelSelection;
+
+// Highest level supported by the CPU (and compiler)
+int getSupportedSimdLevel();
+const char *getSimdLevelName(int level);
+// Kernels are validated against OpenCV and timed on first call (see SIMD_KERNELS_MODE); the result is kept
+const SimdKernelSelection &getSimdKernelSelection();
+
+// Kernels at the given level (must be supported). Return false (dst unchanged) if the input is not handled.
+// Equivalent to cv::cvtColor(src, dst, CV_BGR2GRAY): 8-bit, 3 channels
+bool simdBgrToGray(const cv::Mat &src, cv::Mat &dst, int level);
+// Equivalent to cv::blur(src, dst, ksize): 8-bit, kernel area up to 256, not in place. Rounding of the kernel (half up)
+// may differ from OpenCV for some kernel sizes: see isSimdBoxBlurExact().
+bool simdBoxBlur(const cv::Mat &src, cv::Mat &dst, cv::Size ksize, int level);
+// Whether simdBoxBlur() reproduces cv::blur for the kernel size and number of channels. Validated against OpenCV on
+// first use of each kernel size (result is cached per thread).
+bool isSimdBoxBlurExact(cv::Size ksize, int channels, int level);
+// Equivalent to cv::flip(src, dst, flipCode): 8-bit, 1, 3 or 4 channels, horizontal or both axes, not in place
+bool simdFlip(const cv::Mat &src, cv::Mat &dst, int flipCode, int level);
+
+#endif // SIMDKERNELS_H
@@ -0,0 +1,104 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* StatsRing.h                                                          */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef STATSRING_H
+#define STATSRING_H
+
+#include <QAtomicInteger>
+#include <QVector>
+
+#include <atomic>
+
+// Fixed-size ring of samples from one writer thread, read by one reader thread without locks. The writer never waits:
+// it overwrites the oldest sample. The reader copies the samples written since its last read and discards those
+// which the writer may have overwritten while they were being copied (checked against the number of writes started
+// afterwards, as in a seqlock).
+template<class T> class StatsRing
+{
+    public:
+        StatsRing(int size);
+        void push(const T &sample);
+        int read(quint32 *position, QVector<T> &samples) const;
+
+    private:
+        QVector<T> m_samples;
+        quint32 m_mask;
+        QAtomicInteger<quint32> m_writePosition; // Number of samples written (wraps around)
+        QAtomicInteger<quint32> m_writeStartPosition; // Number of samples of which writing has started
+};
+
+template<class T> StatsRing<T>::StatsRing(int size) : m_writePosition(0), m_writeStartPosition(0)
+{
+    // Size is rounded up to a power of two (positions wrap around consistently)
+    quint32 roundedSize = 1;
+    while ((int)roundedSize < size)
+    {
+        roundedSize <<= 1;
+    }
+    m_samples.resize(roundedSize);
+    m_mask = roundedSize - 1;
+}
+
+template<class T> void StatsRing<T>::push(const T &sample)
+{
+    // Writer only: the start of the write is announced before the slot is modified (release fence: a reader which sees
+    // any part of the new sample also sees the announcement), release makes the sample visible before the new position
+    quint32 position = m_writePosition.load();
+    m_writeStartPosition.store(position + 1);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_samples[position & m_mask] = sample;
+    m_writePosition.storeRelease(position + 1);
+}
+
+template<class T> int StatsRing<T>::read(quint32 *position, QVector<T> &samples) const
+{
+    // Reader only: appends samples written after position (number of samples written at last read) and updates it
+    quint32 size = m_mask + 1;
+    quint32 end = m_writePosition.loadAcquire();
+    quint32 begin = ((end - *position) > size) ? end - size : *position;
+    int first = samples.size();
+    for (quint32 i = begin; i != end; i++)
+    {
+        samples.append(m_samples.at(i & m_mask));
+    }
+    // Samples which may have been overwritten while copying (acquire fence: the slot reads above cannot be reordered
+    // after the load below)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    quint32 writeStart = m_writeStartPosition.load();
+    quint32 nOverwritten = (writeStart - begin) > size ? (writeStart - begin) - size : 0;
+    nOverwritten = qMin(nOverwritten, end - begin);
+    samples.remove(first, (int)nOverwritten);
+    *position = end;
+    return (int)(end - begin - nOverwritten);
+}
+
+#endif // STATSRING_H
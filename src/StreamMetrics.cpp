@@ -0,0 +1,320 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* StreamMetrics.cpp                                                    */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "StreamMetrics.h"
+
+#include "FrameMemoryBudget.h"
+#include "ImageEncoderPool.h"
+#include "ThreadScheduling.h"
+
+namespace {
+    // Label values of processing stages (in order of StageTime)
+    const char* STAGE_NAMES[N_STAGE_TIMES] = {"convert", "grayscale", "smooth", "dilate", "erode", "flip", "canny", "display"};
+
+    void writeFamily(QByteArray &text, const QByteArray &name, const QByteArray &type, const QByteArray &help)
+    {
+        text += "# HELP " + name + " " + help + "\n";
+        text += "# TYPE " + name + " " + type + "\n";
+    }
+
+    void writeSample(QByteArray &text, const QByteArray &name, const QByteArray &labels, const QByteArray &value)
+    {
+        text += name;
+        if (!labels.isEmpty())
+        {
+            text += "{" + labels + "}";
+        }
+        text += " " + value + "\n";
+    }
+
+    QByteArray deviceLabel(int deviceNumber)
+    {
+        return "device=\"" + QByteArray::number(deviceNumber) + "\"";
+    }
+}
+
+const double MetricsHistogram::m_bucketBounds[MetricsHistogram::N_BUCKETS] =
+    {0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5};
+
+MetricsHistogram::MetricsHistogram()
+{
+    for (int i = 0; i <= N_BUCKETS; i++)
+    {
+        m_counts[i] = 0;
+    }
+    m_sum = 0;
+}
+
+void MetricsHistogram::observe(double seconds)
+{
+    int bucket = 0;
+    while ((bucket < N_BUCKETS) && (seconds > m_bucketBounds[bucket]))
+    {
+        bucket++;
+    }
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add((quint64)(qMax(seconds, 0.0) * 1e9), std::memory_order_relaxed);
+}
+
+void MetricsHistogram::write(QByteArray &text, const QByteArray &name, const QByteArray &labels) const
+{
+    // Buckets are cumulative (count of observations less than or equal to bound)
+    QByteArray separator = labels.isEmpty() ? "" : ",";
+    quint64 count = 0;
+    for (int i = 0; i <= N_BUCKETS; i++)
+    {
+        count += m_counts[i].load(std::memory_order_relaxed);
+        QByteArray bound = (i < N_BUCKETS) ? QByteArray::number(m_bucketBounds[i]) : QByteArray("+Inf");
+        writeSample(text, name + "_bucket", labels + separator + "le=\"" + bound + "\"", QByteArray::number(count));
+    }
+    writeSample(text, name + "_sum", labels, QByteArray::number(m_sum.load(std::memory_order_relaxed) / 1e9, 'g', 12));
+    writeSample(text, name + "_count", labels, QByteArray::number(count));
+}
+
+StreamMetrics::StreamMetrics(int deviceNumber)
+{
+    m_deviceNumber = deviceNumber;
+    m_nFramesCaptured = 0;
+    m_nFramesProcessed = 0;
+    m_nFramesDropped = 0;
+    m_nFramesStale = 0;
+    m_nFramesSuperseded = 0;
+    m_nFramesLate = 0;
+    m_nFramesDegraded = 0;
+    m_nScratchAllocations = 0;
+    m_bufferOccupancy = 0;
+    m_bufferSize = 0;
+    m_captureCpuTime = -1;
+    m_processingCpuTime = -1;
+}
+
+int StreamMetrics::getDeviceNumber() const
+{
+    return m_deviceNumber;
+}
+
+void StreamMetrics::updateCapture(const ThreadStatisticsData &statsData, const PerformanceSample &sample, int bufferSize)
+{
+    m_nFramesCaptured.store(statsData.nFramesProcessed, std::memory_order_relaxed);
+    m_nFramesDropped.store(statsData.nFramesDropped, std::memory_order_relaxed);
+    m_bufferOccupancy.store(sample.bufferOccupancy, std::memory_order_relaxed);
+    m_bufferSize.store(bufferSize, std::memory_order_relaxed);
+    m_captureCpuTime.store(getCurrentThreadCpuTime(), std::memory_order_relaxed);
+    // No interval for first frame
+    if (sample.captureInterval > 0.0f)
+    {
+        m_captureInterval.observe(sample.captureInterval / 1000.0);
+    }
+}
+
+void StreamMetrics::updateProcessing(const ThreadStatisticsData &statsData, const PerformanceSample &sample, bool isFrameProcessed)
+{
+    m_nFramesProcessed.store(statsData.nFramesProcessed, std::memory_order_relaxed);
+    m_nFramesStale.store(statsData.nFramesStale, std::memory_order_relaxed);
+    m_nFramesSuperseded.store(statsData.nFramesSuperseded, std::memory_order_relaxed);
+    m_nFramesLate.store(statsData.nFramesLate, std::memory_order_relaxed);
+    m_nFramesDegraded.store(statsData.nFramesDegraded, std::memory_order_relaxed);
+    // Allocations are reported per frame
+    m_nScratchAllocations.fetch_add(statsData.nScratchAllocations, std::memory_order_relaxed);
+    m_processingCpuTime.store(getCurrentThreadCpuTime(), std::memory_order_relaxed);
+    // Frame was skipped (stale, late or decimated)
+    if (!isFrameProcessed)
+    {
+        return;
+    }
+    // Stages which did not run (disabled or skipped) are not observed
+    for (int i = 0; i < N_STAGE_TIMES; i++)
+    {
+        if (sample.stageTimes[i] > 0.0f)
+        {
+            m_stageTimes[i].observe(sample.stageTimes[i] / 1000.0);
+        }
+    }
+    if (statsData.latency >= 0)
+    {
+        m_latency.observe(statsData.latency / 1000.0);
+    }
+}
+
+MetricsRegistry::MetricsRegistry(FrameMemoryBudget *frameMemoryBudget, ImageEncoderPool *imageEncoderPool) :
+    m_frameMemoryBudget(frameMemoryBudget),
+    m_imageEncoderPool(imageEncoderPool)
+{
+}
+
+MetricsRegistry::~MetricsRegistry()
+{
+    qDeleteAll(m_streams);
+}
+
+StreamMetrics* MetricsRegistry::addStream(int deviceNumber)
+{
+    QMutexLocker locker(&m_streamsMutex);
+    delete m_streams.value(deviceNumber, 0);
+    StreamMetrics *streamMetrics = new StreamMetrics(deviceNumber);
+    m_streams[deviceNumber] = streamMetrics;
+    return streamMetrics;
+}
+
+void MetricsRegistry::removeStream(int deviceNumber)
+{
+    // Note: threads updating the stream must have been stopped
+    QMutexLocker locker(&m_streamsMutex);
+    delete m_streams.take(deviceNumber);
+}
+
+QByteArray MetricsRegistry::getText()
+{
+    // Samples of a metric family must be consecutive: write each family for all streams (in order of device number)
+    QMutexLocker locker(&m_streamsMutex);
+    QList<StreamMetrics*> streams = m_streams.values();
+    QByteArray text;
+
+    writeFamily(text, "qt_opencv_frames_captured_total", "counter", "Frames captured (added to or dropped from image buffer).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_frames_captured_total", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_nFramesCaptured.load()));
+    }
+    writeFamily(text, "qt_opencv_frames_processed_total", "counter", "Frames processed.");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_frames_processed_total", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_nFramesProcessed.load()));
+    }
+    writeFamily(text, "qt_opencv_frames_dropped_total", "counter",
+                "Frames not processed: buffer_full (or frame memory budget exceeded), stale (older than maximum age), superseded (newer frame available), late (past deadline).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        QByteArray labels = deviceLabel(streams.at(i)->m_deviceNumber);
+        writeSample(text, "qt_opencv_frames_dropped_total", labels + ",reason=\"buffer_full\"", QByteArray::number(streams.at(i)->m_nFramesDropped.load()));
+        writeSample(text, "qt_opencv_frames_dropped_total", labels + ",reason=\"stale\"", QByteArray::number(streams.at(i)->m_nFramesStale.load()));
+        writeSample(text, "qt_opencv_frames_dropped_total", labels + ",reason=\"superseded\"", QByteArray::number(streams.at(i)->m_nFramesSuperseded.load()));
+        writeSample(text, "qt_opencv_frames_dropped_total", labels + ",reason=\"late\"", QByteArray::number(streams.at(i)->m_nFramesLate.load()));
+    }
+    writeFamily(text, "qt_opencv_frames_degraded_total", "counter", "Frames processed with optional stages skipped.");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_frames_degraded_total", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_nFramesDegraded.load()));
+    }
+    writeFamily(text, "qt_opencv_buffer_occupancy_frames", "gauge", "Frames in image buffer (after last capture).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_buffer_occupancy_frames", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_bufferOccupancy.load()));
+    }
+    writeFamily(text, "qt_opencv_buffer_capacity_frames", "gauge", "Size of image buffer.");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_buffer_capacity_frames", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_bufferSize.load()));
+    }
+    writeFamily(text, "qt_opencv_scratch_allocations_total", "counter", "Images allocated by processing stages (scratch arena misses).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        writeSample(text, "qt_opencv_scratch_allocations_total", deviceLabel(streams.at(i)->m_deviceNumber),
+                    QByteArray::number(streams.at(i)->m_nScratchAllocations.load()));
+    }
+    writeFamily(text, "qt_opencv_thread_cpu_seconds_total", "counter", "CPU time of capture and processing threads (as of last frame).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        QByteArray labels = deviceLabel(streams.at(i)->m_deviceNumber);
+        qint64 captureCpuTime = streams.at(i)->m_captureCpuTime.load();
+        qint64 processingCpuTime = streams.at(i)->m_processingCpuTime.load();
+        // Not available on this platform (or thread has not run yet)
+        if (captureCpuTime >= 0)
+        {
+            writeSample(text, "qt_opencv_thread_cpu_seconds_total", labels + ",thread=\"capture\"", QByteArray::number(captureCpuTime / 1e9, 'g', 12));
+        }
+        if (processingCpuTime >= 0)
+        {
+            writeSample(text, "qt_opencv_thread_cpu_seconds_total", labels + ",thread=\"processing\"", QByteArray::number(processingCpuTime / 1e9, 'g', 12));
+        }
+    }
+    writeFamily(text, "qt_opencv_capture_interval_seconds", "histogram", "Time between consecutive captured frames.");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        streams.at(i)->m_captureInterval.write(text, "qt_opencv_capture_interval_seconds", deviceLabel(streams.at(i)->m_deviceNumber));
+    }
+    writeFamily(text, "qt_opencv_stage_duration_seconds", "histogram", "Time spent in each processing stage (stages which did not run are not observed).");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        for (int stage = 0; stage < N_STAGE_TIMES; stage++)
+        {
+            streams.at(i)->m_stageTimes[stage].write(text, "qt_opencv_stage_duration_seconds",
+                                                     deviceLabel(streams.at(i)->m_deviceNumber) + ",stage=\"" + STAGE_NAMES[stage] + "\"");
+        }
+    }
+    writeFamily(text, "qt_opencv_frame_latency_seconds", "histogram", "Time from capture to end of processing.");
+    for (int i = 0; i < streams.size(); i++)
+    {
+        streams.at(i)->m_latency.write(text, "qt_opencv_frame_latency_seconds", deviceLabel(streams.at(i)->m_deviceNumber));
+    }
+
+    // Frame memory pool (streams without a budget are not listed)
+    if (m_frameMemoryBudget != 0)
+    {
+        writeFamily(text, "qt_opencv_frame_memory_bytes", "gauge", "Memory held by frames in image buffer.");
+        for (int i = 0; i < streams.size(); i++)
+        {
+            int deviceNumber = streams.at(i)->m_deviceNumber;
+            if (m_frameMemoryBudget->containsStream(deviceNumber))
+            {
+                writeSample(text, "qt_opencv_frame_memory_bytes", deviceLabel(deviceNumber), QByteArray::number(m_frameMemoryBudget->getUsage(deviceNumber)));
+            }
+        }
+        writeFamily(text, "qt_opencv_frame_memory_limit_bytes", "gauge", "Part of frame memory budget available to stream (0: unlimited).");
+        for (int i = 0; i < streams.size(); i++)
+        {
+            int deviceNumber = streams.at(i)->m_deviceNumber;
+            if (m_frameMemoryBudget->containsStream(deviceNumber))
+            {
+                writeSample(text, "qt_opencv_frame_memory_limit_bytes", deviceLabel(deviceNumber), QByteArray::number(m_frameMemoryBudget->getLimit(deviceNumber)));
+            }
+        }
+    }
+    // Image encoder pool (shared by all streams)
+    if (m_imageEncoderPool != 0)
+    {
+        ImageEncoderStatisticsData encoderStats = m_imageEncoderPool->getStatistics();
+        writeFamily(text, "qt_opencv_encoder_queue_depth", "gauge", "Jobs waiting in image encoder pool.");
+        writeSample(text, "qt_opencv_encoder_queue_depth", "", QByteArray::number(encoderStats.queueDepth));
+        writeFamily(text, "qt_opencv_encoder_images_encoded_total", "counter", "Images encoded by image encoder pool.");
+        writeSample(text, "qt_opencv_encoder_images_encoded_total", "", QByteArray::number(encoderStats.nImagesEncoded));
+        writeFamily(text, "qt_opencv_encoder_jobs_rejected_total", "counter", "Jobs rejected by image encoder pool (queue full).");
+        writeSample(text, "qt_opencv_encoder_jobs_rejected_total", "", QByteArray::number(encoderStats.nJobsRejected));
+        writeFamily(text, "qt_opencv_encoder_failures_total", "counter", "Images which could not be encoded.");
+        writeSample(text, "qt_opencv_encoder_failures_total", "", QByteArray::number(encoderStats.nEncodeFailures));
+    }
+    return text;
+}
@@ -0,0 +1,113 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* StreamMetrics.h                                                      */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef STREAMMETRICS_H
+#define STREAMMETRICS_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QMutex>
+
+#include <atomic>
+
+#include "Structures.h"
+
+class FrameMemoryBudget;
+class ImageEncoderPool;
+
+// Histogram with fixed buckets (in seconds). Observations are lock-free; there must be one writer only.
+class MetricsHistogram
+{
+    public:
+        MetricsHistogram();
+        void observe(double seconds);
+        // Appends cumulative buckets, sum and count in Prometheus text format
+        void write(QByteArray &text, const QByteArray &name, const QByteArray &labels) const;
+
+    private:
+        enum { N_BUCKETS = 12 };
+        static const double m_bucketBounds[N_BUCKETS];
+        std::atomic<quint64> m_counts[N_BUCKETS + 1]; // Last: above highest bound (+Inf)
+        std::atomic<quint64> m_sum; // ns
+};
+
+// Metrics of one stream: updated by its capture and processing threads, read when exported by MetricsRegistry
+class StreamMetrics
+{
+    public:
+        StreamMetrics(int deviceNumber);
+        // Must be called from capture thread (thread CPU time is sampled)
+        void updateCapture(const ThreadStatisticsData &statsData, const PerformanceSample &sample, int bufferSize);
+        // Must be called from processing thread (thread CPU time is sampled). Stage times and latency are only observed
+        // for processed frames.
+        void updateProcessing(const ThreadStatisticsData &statsData, const PerformanceSample &sample, bool isFrameProcessed);
+        int getDeviceNumber() const;
+
+    private:
+        friend class MetricsRegistry;
+        int m_deviceNumber;
+        std::atomic<quint64> m_nFramesCaptured;
+        std::atomic<quint64> m_nFramesProcessed;
+        std::atomic<quint64> m_nFramesDropped;
+        std::atomic<quint64> m_nFramesStale;
+        std::atomic<quint64> m_nFramesSuperseded;
+        std::atomic<quint64> m_nFramesLate;
+        std::atomic<quint64> m_nFramesDegraded;
+        std::atomic<quint64> m_nScratchAllocations;
+        std::atomic<int> m_bufferOccupancy;
+        std::atomic<int> m_bufferSize;
+        std::atomic<qint64> m_captureCpuTime; // ns (-1 if unknown)
+        std::atomic<qint64> m_processingCpuTime; // ns (-1 if unknown)
+        MetricsHistogram m_captureInterval;
+        MetricsHistogram m_stageTimes[N_STAGE_TIMES];
+        MetricsHistogram m_latency;
+};
+
+// Metrics of all streams and shared resources, exported in Prometheus text format (see HttpServer)
+class MetricsRegistry
+{
+    public:
+        MetricsRegistry(FrameMemoryBudget *frameMemoryBudget, ImageEncoderPool *imageEncoderPool);
+        ~MetricsRegistry();
+        // Returned object is owned by the registry and valid until removeStream() is called
+        StreamMetrics* addStream(int deviceNumber);
+        void removeStream(int deviceNumber);
+        QByteArray getText();
+
+    private:
+        FrameMemoryBudget *m_frameMemoryBudget;
+        ImageEncoderPool *m_imageEncoderPool;
+        QMutex m_streamsMutex;
+        QMap<int, StreamMetrics*> m_streams;
+};
+
+#endif // STREAMMETRICS_H
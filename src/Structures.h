@@ -34,6 +34,7 @@
 #define STRUCTURES_H
 
 #include <QRect>
+#include <QList>
 
 typedef struct
 {
@@ -61,6 +62,30 @@ typedef struct
     bool cannyOn;
 } ImageProcessingFlags;
 
+typedef struct
+{
+    QList<int> cpus; // CPU affinity (empty: all CPUs)
+    int policy; // 0: default (SCHED_OTHER), 1: SCHED_FIFO, 2: SCHED_RR
+    int priority; // Real-time priority (SCHED_FIFO/SCHED_RR only)
+} ThreadSchedulingData;
+
+typedef struct
+{
+    bool enableAdaptiveQuality;
+    int processingDeadline; // ms (0: no deadline)
+    int maxFrameAge; // ms (0: process all frames in order)
+    int backPressureMode;
+    int captureDecimation; // Keep 1 of N frames
+    double captureTargetFps; // 0: no limit
+    int captureFourcc; // 0: default pixel format
+    bool deferColorConversion; // Frames are buffered in the raw (camera) format and converted by the processing thread
+    bool captureGrayscale; // Frames are converted to 8-bit grayscale by the capture thread
+    ThreadSchedulingData captureScheduling;
+    ThreadSchedulingData processingScheduling;
+    bool autoPlaceThreads; // Pin capture and processing threads to CPUs sharing a cache (overrides CPU affinity)
+    bool testPattern; // Synthetic source instead of camera (frames carry capture time, see LatencyBarcode)
+} StreamOptions;
+
 typedef struct
 {
     QRect selectionBox;
@@ -72,6 +97,65 @@ typedef struct
 {
     int averageFPS;
     int nFramesProcessed;
+    int nFramesStale; // Skipped: older than maximum age
+    int nFramesSuperseded; // Skipped: newer frame available (within maximum age)
+    int nFramesLate; // Discarded: past deadline
+    int nFramesDegraded; // Processed with optional stages skipped (to meet deadline)
+    int frameDecimation; // Capture: 1 of N frames decoded
+    int nScratchAllocations; // Processing: images allocated for last frame (0 in steady state)
+    int nFramesDropped; // Capture: not added to full buffer, or dropped to stay within memory budget
+    int latency; // Processing: capture of last frame to end of processing in ms (-1 if unknown)
 } ThreadStatisticsData;
 
+typedef struct
+{
+    int level;
+    int previousLevel;
+    qint64 timestamp; // ms since epoch
+    double bufferOccupancy; // 0-1
+    double utilization; // Fraction of time spent processing (0-1)
+} QualityLevelChangeData;
+
+typedef struct
+{
+    int queueDepth;
+    int maxQueueDepth;
+    quint64 nImagesEncoded;
+    quint64 nJobsRejected;
+    quint64 nEncodeFailures;
+    double averageEncodeTime; // ms
+    double maxEncodeTime; // ms
+} ImageEncoderStatisticsData;
+
+// Processing stages timed per frame (see PerformanceSample)
+enum StageTime
+{
+    StageTimeConvert = 0, // ROI, raw format conversion and scaling
+    StageTimeGrayscale,
+    StageTimeSmooth,
+    StageTimeDilate,
+    StageTimeErode,
+    StageTimeFlip,
+    StageTimeCanny, // Also fused grayscale + blur + Canny
+    StageTimeDisplay, // Conversion to QImage
+    N_STAGE_TIMES
+};
+
+typedef struct
+{
+    qint64 timestamp; // ms (see currentTimestamp())
+    float captureInterval; // Capture: time since previous frame (ms)
+    float stageTimes[N_STAGE_TIMES]; // Processing: ms (0: stage not run)
+    int bufferOccupancy; // Frames in image buffer (capture: after adding frame, processing: after taking frame)
+    int nFramesDropped; // Cumulative (capture: dropped, processing: stale, superseded and late)
+} PerformanceSample;
+
+typedef struct
+{
+    quint32 sequenceNumber; // Frame number of source
+    qint64 captureTimestamp; // ms (see currentTimestamp())
+    qint64 receiveTimestamp; // Frame received by GUI thread
+    qint64 paintTimestamp; // Frame painted
+} LatencyMeasurementData;
+
 #endif // STRUCTURES_H
@@ -0,0 +1,195 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SyntheticFrameSource.cpp                                             */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SyntheticFrameSource.h"
+
+#include "LatencyBarcode.h"
+#include "Timestamp.h"
+#include "Config.h"
+
+#include <QThread>
+
+SyntheticFrameSource::SyntheticFrameSource(double fps) :
+    m_nGrabbedFrames(0),
+    m_nLostFrames(0)
+{
+    m_fps = fps;
+    m_nextFrameTime = 0.0;
+    m_grabTimestamp = -1;
+    m_isLatencyBarcodeEnabled = false;
+    m_width = SYNTHETIC_SOURCE_DEFAULT_WIDTH;
+    m_height = SYNTHETIC_SOURCE_DEFAULT_HEIGHT;
+    m_isOpened = false;
+}
+
+bool SyntheticFrameSource::open()
+{
+    renderPattern();
+    m_clock.start();
+    m_nextFrameTime = 0.0;
+    m_isOpened = true;
+    return true;
+}
+
+bool SyntheticFrameSource::isOpened()
+{
+    return m_isOpened;
+}
+
+void SyntheticFrameSource::release()
+{
+    m_pattern.release();
+    m_isOpened = false;
+}
+
+bool SyntheticFrameSource::grab()
+{
+    if (!m_isOpened)
+    {
+        return false;
+    }
+    if (m_fps > 0.0)
+    {
+        // Frame i is available at time i*period: frames older than the newest available frame are lost
+        double period = 1000.0 / m_fps;
+        double now = m_clock.nsecsElapsed() / 1000000.0;
+        if (now >= m_nextFrameTime + period)
+        {
+            int nLost = (int)((now - m_nextFrameTime) / period);
+            m_nLostFrames.fetchAndAddRelaxed(nLost);
+            m_nextFrameTime += nLost * period;
+        }
+        // Wait for next frame
+        else if (now < m_nextFrameTime)
+        {
+            QThread::usleep((unsigned long)((m_nextFrameTime - now) * 1000.0));
+        }
+        m_nextFrameTime += period;
+    }
+    m_grabTimestamp = currentTimestamp();
+    m_nGrabbedFrames.fetchAndAddRelaxed(1);
+    return true;
+}
+
+bool SyntheticFrameSource::retrieve(cv::Mat &frame)
+{
+    if (!m_isOpened)
+    {
+        return false;
+    }
+    // Pattern moves down by a few rows per frame (frame is a new image, as decoded by a camera driver)
+    int offset = (int)(((qint64)m_nGrabbedFrames.load() * SYNTHETIC_SOURCE_ROWS_PER_FRAME) % m_height);
+    frame.create(m_height, m_width, CV_8UC3);
+    if (offset > 0)
+    {
+        m_pattern.rowRange(m_height - offset, m_height).copyTo(frame.rowRange(0, offset));
+    }
+    m_pattern.rowRange(0, m_height - offset).copyTo(frame.rowRange(offset, m_height));
+    // Time of grabbing and frame number (gaps: frames lost or not retrieved)
+    if (m_isLatencyBarcodeEnabled)
+    {
+        writeLatencyBarcode(frame, m_grabTimestamp, (quint32)m_nGrabbedFrames.load());
+    }
+    return true;
+}
+
+bool SyntheticFrameSource::set(int propId, double value)
+{
+    switch (propId)
+    {
+        case CV_CAP_PROP_FRAME_WIDTH:
+            m_width = qMax((int)value, 1);
+            break;
+        case CV_CAP_PROP_FRAME_HEIGHT:
+            m_height = qMax((int)value, 1);
+            break;
+        case CV_CAP_PROP_FPS:
+            m_fps = qMax(value, 0.0);
+            return true;
+        // Only BGR frames are supported
+        default:
+            return false;
+    }
+    if (m_isOpened)
+    {
+        renderPattern();
+    }
+    return true;
+}
+
+double SyntheticFrameSource::get(int propId)
+{
+    switch (propId)
+    {
+        case CV_CAP_PROP_FRAME_WIDTH:
+            return m_width;
+        case CV_CAP_PROP_FRAME_HEIGHT:
+            return m_height;
+        case CV_CAP_PROP_FPS:
+            return m_fps;
+        default:
+            return 0.0;
+    }
+}
+
+void SyntheticFrameSource::setLatencyBarcodeEnabled(bool enable)
+{
+    m_isLatencyBarcodeEnabled = enable;
+}
+
+int SyntheticFrameSource::getGrabbedFrameCount()
+{
+    return m_nGrabbedFrames.load();
+}
+
+int SyntheticFrameSource::getLostFrameCount()
+{
+    return m_nLostFrames.load();
+}
+
+void SyntheticFrameSource::renderPattern()
+{
+    // Gradients with noise: edges and texture for the processing stages (a constant image would be unrealistically cheap)
+    m_pattern.create(m_height, m_width, CV_8UC3);
+    cv::RNG rng(0x5EED);
+    rng.fill(m_pattern, cv::RNG::UNIFORM, 0, 64);
+    for (int y = 0; y < m_height; y++)
+    {
+        uchar *row = m_pattern.ptr<uchar>(y);
+        for (int x = 0; x < m_width; x++)
+        {
+            row[x * 3] += (uchar)((x * 192) / m_width);
+            row[x * 3 + 1] += (uchar)((y * 192) / m_height);
+            row[x * 3 + 2] += (uchar)((((x / 32) + (y / 32)) % 2) * 192);
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SyntheticFrameSource.h                                               */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef SYNTHETICFRAMESOURCE_H
+#define SYNTHETICFRAMESOURCE_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+
+#include "FrameSource.h"
+
+// Camera simulated in software (e.g. for soak tests and capacity planning without cameras): BGR frames of a moving
+// pattern at a fixed frame rate. As with a camera driver, frames which are not grabbed in time are lost (the newest
+// frame is delivered). Resolution and frame rate are set with CV_CAP_PROP_FRAME_WIDTH/HEIGHT and CV_CAP_PROP_FPS.
+// Optionally, the time of grabbing and the number of the frame are written into each frame (see LatencyBarcode).
+class SyntheticFrameSource : public FrameSource
+{
+    public:
+        SyntheticFrameSource(double fps);
+        bool open();
+        bool isOpened();
+        void release();
+        bool grab();
+        bool retrieve(cv::Mat &frame);
+        bool set(int propId, double value);
+        double get(int propId);
+        void setLatencyBarcodeEnabled(bool enable);
+        // Counters (may be read from any thread)
+        int getGrabbedFrameCount();
+        int getLostFrameCount();
+
+    private:
+        void renderPattern();
+        cv::Mat m_pattern;
+        QElapsedTimer m_clock;
+        QAtomicInt m_nGrabbedFrames;
+        QAtomicInt m_nLostFrames;
+        double m_fps; // 0: as fast as frames are grabbed
+        double m_nextFrameTime; // ms
+        qint64 m_grabTimestamp; // Time of grabbing the current frame (see currentTimestamp())
+        bool m_isLatencyBarcodeEnabled;
+        int m_width;
+        int m_height;
+        bool m_isOpened;
+};
+
+#endif // SYNTHETICFRAMESOURCE_H
@@ -0,0 +1,178 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ThreadScheduling.cpp                                                 */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "ThreadScheduling.h"
+
+#include <QFile>
+#include <QStringList>
+#include <QThread>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#endif
+
+namespace {
+    QString readSysFile(const QString &path)
+    {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly))
+        {
+            return QString();
+        }
+        return QString::fromLatin1(file.readAll()).trimmed();
+    }
+}
+
+QList<int> parseCpuList(const QString &text)
+{
+    QList<int> cpus;
+    foreach (const QString &entry, text.split(',', QString::SkipEmptyParts))
+    {
+        QStringList range = entry.trimmed().split('-');
+        bool isFirstValid, isLastValid;
+        int first = range.first().toInt(&isFirstValid);
+        int last = range.last().toInt(&isLastValid);
+        if (!isFirstValid || !isLastValid || (range.size() > 2) || (first < 0) || (last < first))
+        {
+            continue;
+        }
+        for (int cpu = first; cpu <= last; cpu++)
+        {
+            if (!cpus.contains(cpu))
+            {
+                cpus.append(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+QList< QList<int> > getCpuCacheGroups()
+{
+    QList< QList<int> > groups;
+    int nCpus = QThread::idealThreadCount();
+    for (int cpu = 0; cpu < nCpus; cpu++)
+    {
+        // Already part of a group
+        bool isGrouped = false;
+        foreach (const QList<int> &group, groups)
+        {
+            isGrouped = isGrouped || group.contains(cpu);
+        }
+        if (isGrouped)
+        {
+            continue;
+        }
+        // CPUs sharing L2 cache (index2), else hyper-threading siblings, else CPU alone
+        QString cpuPath = QString("/sys/devices/system/cpu/cpu%1/").arg(cpu);
+        QList<int> group = parseCpuList(readSysFile(cpuPath + "cache/index2/shared_cpu_list"));
+        if (group.isEmpty())
+        {
+            group = parseCpuList(readSysFile(cpuPath + "topology/thread_siblings_list"));
+        }
+        if (!group.contains(cpu))
+        {
+            group.clear();
+            group.append(cpu);
+        }
+        groups.append(group);
+    }
+    return groups;
+}
+
+QList<int> getAutoPlacementCpus(int slot)
+{
+    QList< QList<int> > groups = getCpuCacheGroups();
+    if (groups.isEmpty())
+    {
+        return QList<int>();
+    }
+    return groups.at(qAbs(slot) % groups.size());
+}
+
+bool applyThreadScheduling(const ThreadSchedulingData &schedulingData)
+{
+#ifdef Q_OS_LINUX
+    bool isApplied = true;
+    // CPU affinity
+    if (!schedulingData.cpus.isEmpty())
+    {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        foreach (int cpu, schedulingData.cpus)
+        {
+            if (cpu < CPU_SETSIZE)
+            {
+                CPU_SET(cpu, &cpuSet);
+            }
+        }
+        int result = pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+        if (result != 0)
+        {
+            qDebug() << "WARNING: Could not set CPU affinity (error" << result << ").";
+            isApplied = false;
+        }
+    }
+    // Real-time scheduling (requires CAP_SYS_NICE or a suitable RLIMIT_RTPRIO)
+    if (schedulingData.policy != 0)
+    {
+        int policy = (schedulingData.policy == 1) ? SCHED_FIFO : SCHED_RR;
+        struct sched_param param;
+        param.sched_priority = qBound(sched_get_priority_min(policy), schedulingData.priority, sched_get_priority_max(policy));
+        int result = pthread_setschedparam(pthread_self(), policy, &param);
+        if (result != 0)
+        {
+            qDebug() << "WARNING: Could not set real-time scheduling policy (error" << result << ").";
+            isApplied = false;
+        }
+    }
+    return isApplied;
+#else
+    // Not supported on this platform
+    return schedulingData.cpus.isEmpty() && (schedulingData.policy == 0);
+#endif
+}
+
+qint64 getCurrentThreadCpuTime()
+{
+#ifdef Q_OS_LINUX
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+    {
+        return (qint64)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    }
+#endif
+    return -1;
+}
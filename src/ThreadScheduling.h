@@ -0,0 +1,52 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* ThreadScheduling.h                                                   */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef THREADSCHEDULING_H
+#define THREADSCHEDULING_H
+
+#include <QList>
+#include <QString>
+
+#include "Structures.h"
+
+// Parses a CPU list such as "0-3,6" (format of Linux sysfs and taskset). Invalid entries are ignored.
+QList<int> parseCpuList(const QString &text);
+// Groups of CPUs sharing an L2 cache (falls back to hyper-threading siblings, then to single CPUs)
+QList< QList<int> > getCpuCacheGroups();
+// CPUs for auto-placement: threads of the same slot (stream) share a cache group, slots are spread over groups
+QList<int> getAutoPlacementCpus(int slot);
+// Applies CPU affinity and scheduling policy to the calling thread (Linux only). Returns false if any part failed.
+bool applyThreadScheduling(const ThreadSchedulingData &schedulingData);
+// CPU time consumed by the calling thread (ns, -1 if not available on this platform)
+qint64 getCurrentThreadCpuTime();
+
+#endif // THREADSCHEDULING_H
@@ -0,0 +1,92 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* TripleBuffer.h                                                       */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <QAtomicInt>
+
+// Hands the latest value from one writer thread to one reader thread without locks. The writer fills the back
+// slot and swaps it with the middle slot; the reader swaps the middle slot with its front slot when a new value
+// has been published. Neither side ever waits for the other, and a slot is never read and written at the same time.
+template<class T> class TripleBuffer
+{
+    public:
+        TripleBuffer();
+        T &write();
+        void publish();
+        bool update();
+        const T &read() const;
+
+    private:
+        // Middle slot index, with flag set if it holds a value which the reader has not taken yet
+        enum { IndexMask = 0x3, NewValueFlag = 0x4 };
+        T m_slots[3];
+        int m_back;
+        int m_front;
+        QAtomicInt m_middle;
+};
+
+template<class T> TripleBuffer<T>::TripleBuffer() : m_back(0), m_front(1), m_middle(2)
+{
+}
+
+template<class T> T &TripleBuffer<T>::write()
+{
+    // Writer only
+    return m_slots[m_back];
+}
+
+template<class T> void TripleBuffer<T>::publish()
+{
+    // Writer only: release makes the contents of the slot visible to the reader
+    m_back = m_middle.fetchAndStoreOrdered(m_back | NewValueFlag) & IndexMask;
+}
+
+template<class T> bool TripleBuffer<T>::update()
+{
+    // Reader only: returns true if a new value was taken
+    if (!(m_middle.loadAcquire() & NewValueFlag))
+    {
+        return false;
+    }
+    m_front = m_middle.fetchAndStoreOrdered(m_front) & IndexMask;
+    return true;
+}
+
+template<class T> const T &TripleBuffer<T>::read() const
+{
+    // Reader only
+    return m_slots[m_front];
+}
+
+#endif // TRIPLEBUFFER_H
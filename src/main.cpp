@@ -31,6 +31,7 @@
 /************************************************************************/
 
 #include "MainWindow.h"
+#include "SimdKernels.h"
 
 #include <QApplication>
 
@@ -38,6 +39,8 @@ int main(int argc, char *argv[])
 {
     // Show main window
     QApplication a(argc, argv);
+    // Select image processing kernels (validation and timing against OpenCV) before any processing thread starts
+    getSimdKernelSelection();
     MainWindow w;
     w.show();
     // Start event loop
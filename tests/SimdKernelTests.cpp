@@ -0,0 +1,231 @@
+/************************************************************************/
+/* qt-opencv-multithreaded:                                             */
+/* A multithreaded OpenCV application using the Qt framework.           */
+/*                                                                      */
+/* SimdKernelTests.cpp                                                  */
+/*                                                                      */
+/* Nick D'Ademo <nickdademo@gmail.com>                                  */
+/*                                                                      */
+/* Copyright (c) 2012-2015 Nick D'Ademo                                 */
+/*                                                                      */
+/* Permission is hereby granted, free of charge, to any person          */
+/* obtaining a copy of this software and associated documentation       */
+/* files (the "Software"), to deal in the Software without restriction, */
+/* including without limitation the rights to use, copy, modify, merge, */
+/* publish, distribute, sublicense, and/or sell copies of the Software, */
+/* and to permit persons to whom the Software is furnished to do so,    */
+/* subject to the following conditions:                                 */
+/*                                                                      */
+/* The above copyright notice and this permission notice shall be       */
+/* included in all copies or substantial portions of the Software.      */
+/*                                                                      */
+/* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,      */
+/* EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF   */
+/* MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND                */
+/* NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS  */
+/* BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN   */
+/* ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN    */
+/* CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE     */
+/* SOFTWARE.                                                            */
+/*                                                                      */
+/************************************************************************/
+
+#include "SimdKernels.h"
+#include "ImageFilters.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+
+#include <vector>
+
+// Reference tests of the hand-vectorized kernels (SimdKernels.h) and of the dispatching functions (ImageFilters.h):
+// output must be identical to OpenCV for all levels supported by this CPU
+namespace {
+    cv::Mat makeTestImage(cv::Size size, int type, quint64 seed)
+    {
+        cv::Mat image(size, type);
+        cv::RNG rng(seed);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        return image;
+    }
+
+    bool isEqual(const cv::Mat &a, const cv::Mat &b)
+    {
+        return (a.size() == b.size()) && (a.type() == b.type()) && (cv::norm(a, b, cv::NORM_INF) == 0);
+    }
+
+    // Image sizes: single pixel, smaller than kernels, odd widths (row remainders of all vector widths), VGA
+    std::vector<cv::Size> getImageSizes()
+    {
+        std::vector<cv::Size> sizes;
+        sizes.push_back(cv::Size(1, 1));
+        sizes.push_back(cv::Size(2, 3));
+        sizes.push_back(cv::Size(7, 5));
+        sizes.push_back(cv::Size(33, 17));
+        sizes.push_back(cv::Size(161, 97));
+        sizes.push_back(cv::Size(640, 480));
+        return sizes;
+    }
+
+    int testBgrToGray(int level)
+    {
+        int nFailures = 0;
+        std::vector<cv::Size> sizes = getImageSizes();
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            cv::Mat src = makeTestImage(sizes.at(i), CV_8UC3, i + 1);
+            cv::Mat dst, reference;
+            cv::cvtColor(src, reference, CV_BGR2GRAY);
+            if (!simdBgrToGray(src, dst, level) || !isEqual(dst, reference))
+            {
+                qWarning() << "FAILED: bgrToGray (" << getSimdLevelName(level) << ")" << src.cols << "x" << src.rows;
+                nFailures++;
+            }
+        }
+        return nFailures;
+    }
+
+    int testFlip(int level)
+    {
+        int nFailures = 0;
+        std::vector<cv::Size> sizes = getImageSizes();
+        const int types[] = { CV_8UC1, CV_8UC3, CV_8UC4 };
+        const int flipCodes[] = { 1, -1 };
+        for (size_t i = 0; i < sizes.size(); i++)
+        {
+            for (int type : types)
+            {
+                for (int flipCode : flipCodes)
+                {
+                    cv::Mat src = makeTestImage(sizes.at(i), type, i + 1);
+                    cv::Mat dst, reference;
+                    cv::flip(src, reference, flipCode);
+                    if (!simdFlip(src, dst, flipCode, level) || !isEqual(dst, reference))
+                    {
+                        qWarning() << "FAILED: flip (" << getSimdLevelName(level) << ")" << src.cols << "x" << src.rows
+                                   << CV_MAT_CN(type) << "channel(s), flip code" << flipCode;
+                        nFailures++;
+                    }
+                }
+            }
+        }
+        return nFailures;
+    }
+
+    // Kernel sizes: all sizes up to 16x16 and long one-dimensional kernels (area up to 256)
+    std::vector<cv::Size> getBoxBlurKernelSizes()
+    {
+        std::vector<cv::Size> sizes;
+        for (int height = 1; height <= 16; height++)
+        {
+            for (int width = 1; width <= 16; width++)
+            {
+                sizes.push_back(cv::Size(width, height));
+            }
+        }
+        sizes.push_back(cv::Size(1, 31));
+        sizes.push_back(cv::Size(31, 1));
+        sizes.push_back(cv::Size(3, 85));
+        sizes.push_back(cv::Size(85, 3));
+        sizes.push_back(cv::Size(1, 256));
+        sizes.push_back(cv::Size(256, 1));
+        return sizes;
+    }
+
+    // Kernel sizes which do not reproduce cv::blur must be detected (OpenCV is used for them instead)
+    int testBoxBlur(int level)
+    {
+        int nFailures = 0;
+        int nFallbacks = 0;
+        std::vector<cv::Size> sizes = getImageSizes();
+        std::vector<cv::Size> kernelSizes = getBoxBlurKernelSizes();
+        const int types[] = { CV_8UC1, CV_8UC3, CV_8UC4 };
+        for (const cv::Size &kernelSize : kernelSizes)
+        {
+            for (int type : types)
+            {
+                if (!isSimdBoxBlurExact(kernelSize, CV_MAT_CN(type), level))
+                {
+                    nFallbacks++;
+                    continue;
+                }
+                for (size_t i = 0; i < sizes.size(); i++)
+                {
+                    cv::Mat src = makeTestImage(sizes.at(i), type, i + 1);
+                    cv::Mat dst, reference;
+                    cv::blur(src, reference, kernelSize);
+                    if (!simdBoxBlur(src, dst, kernelSize, level) || !isEqual(dst, reference))
+                    {
+                        qWarning() << "FAILED: boxBlur (" << getSimdLevelName(level) << ")" << src.cols << "x" << src.rows
+                                   << CV_MAT_CN(type) << "channel(s), kernel" << kernelSize.width << "x" << kernelSize.height;
+                        nFailures++;
+                    }
+                }
+            }
+        }
+        qDebug() << "boxBlur (" << getSimdLevelName(level) << "):" << nFallbacks << "of" << kernelSizes.size() * 3
+                 << "kernel sizes/channel counts use OpenCV";
+        return nFailures;
+    }
+
+    // Functions used by the processing stages (kernels selected at startup or OpenCV)
+    int testDispatched()
+    {
+        int nFailures = 0;
+        std::vector<cv::Size> kernelSizes = getBoxBlurKernelSizes();
+        const int types[] = { CV_8UC1, CV_8UC3 };
+        for (int type : types)
+        {
+            cv::Mat src = makeTestImage(cv::Size(161, 97), type, 0x5EED);
+            cv::Mat dst, reference;
+            for (const cv::Size &kernelSize : kernelSizes)
+            {
+                cv::blur(src, reference, kernelSize);
+                boxBlur(src, dst, kernelSize);
+                if (!isEqual(dst, reference))
+                {
+                    qWarning() << "FAILED: boxBlur (dispatched)" << CV_MAT_CN(type) << "channel(s), kernel" << kernelSize.width << "x" << kernelSize.height;
+                    nFailures++;
+                }
+            }
+            cv::flip(src, reference, 1);
+            flipImage(src, dst, 1);
+            if (!isEqual(dst, reference))
+            {
+                qWarning() << "FAILED: flip (dispatched)" << CV_MAT_CN(type) << "channel(s)";
+                nFailures++;
+            }
+        }
+        cv::Mat src = makeTestImage(cv::Size(161, 97), CV_8UC3, 0x5EED);
+        cv::Mat dst, reference;
+        cv::cvtColor(src, reference, CV_BGR2GRAY);
+        bgrToGray(src, dst);
+        if (!isEqual(dst, reference))
+        {
+            qWarning() << "FAILED: bgrToGray (dispatched)";
+            nFailures++;
+        }
+        return nFailures;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    int nFailures = 0;
+    // All levels supported by this CPU (not only the selected ones)
+    for (int level = SimdScalar; level <= getSupportedSimdLevel(); level++)
+    {
+        nFailures += testBgrToGray(level);
+        nFailures += testFlip(level);
+        nFailures += testBoxBlur(level);
+    }
+    nFailures += testDispatched();
+    if (nFailures > 0)
+    {
+        qWarning() << nFailures << "case(s) FAILED";
+        return 1;
+    }
+    qDebug() << "All SIMD kernel tests passed";
+    return 0;
+}